@@ -0,0 +1,122 @@
+#include <pthread.h>
+#include <qr/append.h>
+#include <qr/enc.h>
+#include <qr/qr.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+typedef struct
+{
+	qr_ec_level level;
+	unsigned version;
+	qr_segment *segments;
+	size_t count;
+	qr_code *qr;
+} symbol_job;
+
+word
+qr_append_parity(const char *data, size_t length)
+{
+	size_t i;
+	word parity = 0;
+
+	for (i = 0; i < length; ++i)
+		parity ^= (word) data[i];
+
+	return parity;
+}
+
+static size_t
+chunk_end(const char *data, size_t length, int kanji, size_t start, size_t target)
+{
+	while (start < target)
+		start += qr_character_length(data + start, length - start, kanji);
+
+	return start;
+}
+
+// splits data into total chunks of roughly equal size on character
+// boundaries; fails if any chunk needs a version above max_version
+static int
+plan_symbols(const char *data, size_t length, int kanji, qr_ec_level level, unsigned max_version, const qr_segment *header, size_t header_count, unsigned total, symbol_job *jobs)
+{
+	size_t i, start = 0, end, prefix;
+	word parity = qr_append_parity(data, length);
+
+	for (i = 0; i < total; ++i)
+	{
+		end = chunk_end(data, length, kanji, start, start + ((length - start + (total - i) - 1) / (total - i)));
+
+		jobs[i].level = level;
+		jobs[i].segments = malloc((2 + header_count + (end - start)) * sizeof(*jobs[i].segments));
+
+		prefix = 0;
+		if (total > 1)
+			jobs[i].segments[prefix++] = (qr_segment) { .mode = QR_MODE_STRUCTURED_APPEND, .append = { i, total, parity } };
+		for (; prefix < (total > 1) + header_count; ++prefix)
+			jobs[i].segments[prefix] = header[prefix - (total > 1)];
+
+		jobs[i].count = qr_segments_optimize(data + start, end - start, kanji, level, jobs[i].segments, prefix, &jobs[i].version);
+		if (jobs[i].version > max_version)
+		{
+			for (; i < total; --i)
+				free(jobs[i].segments);
+			return -1;
+		}
+
+		start = end;
+	}
+
+	return 0;
+}
+
+static void *
+encode_symbol(void *arg)
+{
+	symbol_job *job = arg;
+
+	job->qr = qr_create(job->level, job->segments[job->count - 1].mode, job->version);
+	qr_encode_segments(job->qr, job->segments, job->count);
+
+	return NULL;
+}
+
+// encodes data into as few symbols of at most max_version as possible, using
+// structured append if more than one is needed; header segments (e.g. ECI)
+// are repeated in every symbol. returns the number of symbols, 0 if the data
+// does not fit into QR_APPEND_MAX_SYMBOLS
+size_t
+qr_append_encode(const char *data, size_t length, int kanji, qr_ec_level level, unsigned max_version, const qr_segment *header, size_t header_count, qr_code *symbols[QR_APPEND_MAX_SYMBOLS])
+{
+	symbol_job jobs[QR_APPEND_MAX_SYMBOLS];
+	pthread_t threads[QR_APPEND_MAX_SYMBOLS];
+	int started[QR_APPEND_MAX_SYMBOLS];
+	unsigned i, total;
+
+	for (total = 1; total <= QR_APPEND_MAX_SYMBOLS; ++total)
+		if (!plan_symbols(data, length, kanji, level, max_version, header, header_count, total, jobs))
+			break;
+
+	if (total > QR_APPEND_MAX_SYMBOLS)
+		return 0;
+
+	// the first symbol is encoded on the calling thread, as are all symbols
+	// whose thread could not be started
+	for (i = 1; i < total; ++i)
+		started[i] = !pthread_create(&threads[i], NULL, encode_symbol, &jobs[i]);
+	encode_symbol(&jobs[0]);
+
+	for (i = 0; i < total; ++i)
+	{
+		if (i && started[i])
+			pthread_join(threads[i], NULL);
+		else if (i)
+			encode_symbol(&jobs[i]);
+
+		symbols[i] = jobs[i].qr;
+		free(jobs[i].segments);
+	}
+
+	return total;
+}
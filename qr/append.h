@@ -0,0 +1,12 @@
+#ifndef QR_APPEND_H
+#define QR_APPEND_H
+
+#include <qr/types.h>
+#include <stddef.h>
+
+#define QR_APPEND_MAX_SYMBOLS 16
+
+word qr_append_parity(const char *data, size_t length);
+size_t qr_append_encode(const char *data, size_t length, int kanji, qr_ec_level level, unsigned max_version, const qr_segment *header, size_t header_count, qr_code *symbols[QR_APPEND_MAX_SYMBOLS]);
+
+#endif // QR_APPEND_H
@@ -0,0 +1,139 @@
+#include <qr/batch.h>
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+void
+qr_batch_reader_init(qr_batch_reader *reader, FILE *stream, int delimiter)
+{
+	reader->stream = stream;
+	reader->delimiter = delimiter;
+	reader->record = NULL;
+	reader->capacity = 0;
+	reader->index = 0;
+}
+
+// returns the next record without its delimiter as a string, NULL after
+// the last one, the record stays valid until the next call. lines may end
+// with CRLF, so that files written on Windows give the same payloads
+const char *
+qr_batch_next(qr_batch_reader *reader, size_t *length)
+{
+	ssize_t read = getdelim(&reader->record, &reader->capacity, reader->delimiter, reader->stream);
+
+	if (read < 0) return NULL;
+
+	if (read > 0 && reader->record[read - 1] == reader->delimiter)
+	{
+		reader->record[--read] = '\0';
+		if (reader->delimiter == '\n' && read > 0 && reader->record[read - 1] == '\r')
+			reader->record[--read] = '\0';
+	}
+
+	++reader->index;
+	*length = read;
+	return reader->record;
+}
+
+void
+qr_batch_reader_free(qr_batch_reader *reader)
+{
+	free(reader->record);
+	reader->record = NULL;
+	reader->capacity = 0;
+}
+
+// FNV-1a, the same on every host so that shards agree
+uint64_t
+qr_batch_hash(const void *data, size_t length)
+{
+	const unsigned char *bytes = data;
+	uint64_t hash = 0xCBF29CE484222325;
+
+	while (length--)
+	{
+		hash ^= *bytes++;
+		hash *= 0x100000001B3;
+	}
+
+	return hash;
+}
+
+// returns the shard from 1 to count of a record, by its number from 1 or by
+// its payload, so that equal payloads end up in the same shard
+unsigned
+qr_batch_shard(size_t number, const void *data, size_t length, unsigned count, int by_hash)
+{
+	return 1 + (by_hash ? qr_batch_hash(data, length) : number - 1) % count;
+}
+
+// a pattern names every record differently if it contains %n
+int
+qr_batch_pattern_is_valid(const char *pattern)
+{
+	for (; *pattern; ++pattern)
+	{
+		if (*pattern != '%') continue;
+		if (*++pattern == 'n') return 1;
+		if (*pattern != '%') return 0;
+	}
+
+	return 0;
+}
+
+// expands %n to the record number and %% to a percent sign, returns the
+// length of the whole path like snprintf
+size_t
+qr_batch_path(const char *pattern, size_t number, char *path, size_t size)
+{
+	char digits[24];
+	size_t length = 0, i;
+
+	for (; *pattern; ++pattern)
+	{
+		if (*pattern == '%' && pattern[1] == 'n')
+		{
+			snprintf(digits, sizeof(digits), "%zu", number);
+			for (i = 0; digits[i]; ++i, ++length)
+				if (length + 1 < size) path[length] = digits[i];
+			++pattern;
+			continue;
+		}
+
+		if (*pattern == '%' && pattern[1] == '%') ++pattern;
+		if (length + 1 < size) path[length] = *pattern;
+		++length;
+	}
+
+	if (size) path[length < size ? length : size - 1] = '\0';
+	return length;
+}
+
+static void
+put_uint32(qr_sink *sink, size_t value)
+{
+	uint8_t bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+
+	qr_sink_put(sink, bytes, sizeof(bytes));
+}
+
+// a big endian 32-bit length followed by the data, a failed record is an
+// empty one so that the records stay in step with the input
+void
+qr_batch_put_record(qr_sink *sink, const void *data, size_t length)
+{
+	put_uint32(sink, length);
+	if (length) qr_sink_put(sink, data, length);
+}
+
+// records written as they complete carry the number of their input record
+void
+qr_batch_put_numbered_record(qr_sink *sink, size_t number, const void *data, size_t length)
+{
+	put_uint32(sink, number);
+	qr_batch_put_record(sink, data, length);
+}
@@ -0,0 +1,30 @@
+#ifndef QR_BATCH_H
+#define QR_BATCH_H
+
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct
+{
+	FILE *stream;
+	int delimiter;  // '\n' or '\0'
+	char *record;
+	size_t capacity;
+	size_t index;   // of the next record, counting from 0
+} qr_batch_reader;
+
+void qr_batch_reader_init(qr_batch_reader *reader, FILE *stream, int delimiter);
+const char *qr_batch_next(qr_batch_reader *reader, size_t *length);
+void qr_batch_reader_free(qr_batch_reader *reader);
+
+uint64_t qr_batch_hash(const void *data, size_t length);
+unsigned qr_batch_shard(size_t number, const void *data, size_t length, unsigned count, int by_hash);
+
+int qr_batch_pattern_is_valid(const char *pattern);
+size_t qr_batch_path(const char *pattern, size_t number, char *path, size_t size);
+void qr_batch_put_record(qr_sink *sink, const void *data, size_t length);
+void qr_batch_put_numbered_record(qr_sink *sink, size_t number, const void *data, size_t length);
+
+#endif // QR_BATCH_H
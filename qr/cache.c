@@ -0,0 +1,200 @@
+#include <pthread.h>
+#include <qr/batch.h>
+#include <qr/cache.h>
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INITIAL_BUCKETS 64
+
+void
+qr_cache_init(qr_cache *cache, size_t budget)
+{
+	pthread_mutex_init(&cache->lock, NULL);
+	cache->budget = budget;
+	cache->used = 0;
+	cache->bucket_count = INITIAL_BUCKETS;
+	cache->buckets = calloc(cache->bucket_count, sizeof(*cache->buckets));
+	cache->count = 0;
+	cache->newest = cache->oldest = NULL;
+	cache->hits = cache->misses = cache->evictions = 0;
+}
+
+static size_t
+entry_size(const qr_cache_entry *entry)
+{
+	return sizeof(*entry) + entry->key_length + entry->size;
+}
+
+static qr_cache_entry **
+find(qr_cache *cache, uint64_t hash, const void *key, size_t key_length)
+{
+	qr_cache_entry **entry = &cache->buckets[hash & (cache->bucket_count - 1)];
+
+	for (; *entry; entry = &(*entry)->chain)
+		if ((*entry)->hash == hash && (*entry)->key_length == key_length && !memcmp((*entry)->data, key, key_length))
+			break;
+
+	return entry;
+}
+
+static void
+unlink_recent(qr_cache *cache, qr_cache_entry *entry)
+{
+	if (entry->newer) entry->newer->older = entry->older;
+	else cache->newest = entry->older;
+	if (entry->older) entry->older->newer = entry->newer;
+	else cache->oldest = entry->newer;
+}
+
+static void
+link_newest(qr_cache *cache, qr_cache_entry *entry)
+{
+	entry->newer = NULL;
+	entry->older = cache->newest;
+	if (cache->newest) cache->newest->newer = entry;
+	else cache->oldest = entry;
+	cache->newest = entry;
+}
+
+// takes the entry out of the buckets and the recency list, an entry that is
+// being read is freed by its last reader
+static void
+remove_entry(qr_cache *cache, qr_cache_entry **slot)
+{
+	qr_cache_entry *entry = *slot;
+
+	*slot = entry->chain;
+	unlink_recent(cache, entry);
+	cache->used -= entry_size(entry);
+	--cache->count;
+
+	if (entry->pins) entry->removed = 1;
+	else free(entry);
+}
+
+static void
+evict_oldest(qr_cache *cache)
+{
+	qr_cache_entry *oldest = cache->oldest;
+
+	remove_entry(cache, find(cache, oldest->hash, oldest->data, oldest->key_length));
+	++cache->evictions;
+}
+
+// doubles the buckets once there are as many entries as buckets
+static void
+grow(qr_cache *cache)
+{
+	qr_cache_entry **buckets, *entry, *next;
+	size_t i, count = 2 * cache->bucket_count;
+
+	if (!(buckets = calloc(count, sizeof(*buckets))))
+		return;
+
+	for (i = 0; i < cache->bucket_count; ++i)
+	{
+		for (entry = cache->buckets[i]; entry; entry = next)
+		{
+			next = entry->chain;
+			entry->chain = buckets[entry->hash & (count - 1)];
+			buckets[entry->hash & (count - 1)] = entry;
+		}
+	}
+
+	free(cache->buckets);
+	cache->buckets = buckets;
+	cache->bucket_count = count;
+}
+
+// writes the value of key to the sink and returns 1 if it is cached. the
+// entry is pinned while it is written, so a slow sink does not hold the lock
+int
+qr_cache_get(qr_cache *cache, const void *key, size_t key_length, qr_sink *sink)
+{
+	qr_cache_entry *entry;
+	int unused;
+
+	pthread_mutex_lock(&cache->lock);
+	entry = *find(cache, qr_batch_hash(key, key_length), key, key_length);
+	if (entry)
+	{
+		++cache->hits;
+		++entry->pins;
+		unlink_recent(cache, entry);
+		link_newest(cache, entry);
+	}
+	else
+	{
+		++cache->misses;
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	if (!entry)
+		return 0;
+
+	qr_sink_put(sink, entry->data + entry->key_length, entry->size);
+
+	pthread_mutex_lock(&cache->lock);
+	unused = !--entry->pins && entry->removed;
+	pthread_mutex_unlock(&cache->lock);
+	if (unused) free(entry);
+
+	return 1;
+}
+
+// stores a copy of the value, replacing an earlier one of the same key; a
+// value that does not fit into the whole budget is not stored
+void
+qr_cache_put(qr_cache *cache, const void *key, size_t key_length, const void *value, size_t size)
+{
+	uint64_t hash = qr_batch_hash(key, key_length);
+	qr_cache_entry *entry, **slot;
+
+	if (sizeof(*entry) + key_length + size > cache->budget)
+		return;
+
+	if (!(entry = malloc(sizeof(*entry) + key_length + size)))
+		return;
+	entry->hash = hash;
+	entry->key_length = key_length;
+	entry->size = size;
+	entry->pins = 0;
+	entry->removed = 0;
+	memcpy(entry->data, key, key_length);
+	memcpy(entry->data + key_length, value, size);
+
+	pthread_mutex_lock(&cache->lock);
+	if (*(slot = find(cache, hash, key, key_length)))
+		remove_entry(cache, slot);
+
+	while (cache->used + entry_size(entry) > cache->budget)
+		evict_oldest(cache);
+	if (cache->count >= cache->bucket_count)
+		grow(cache);
+
+	slot = &cache->buckets[hash & (cache->bucket_count - 1)];
+	entry->chain = *slot;
+	*slot = entry;
+	link_newest(cache, entry);
+	cache->used += entry_size(entry);
+	++cache->count;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void
+qr_cache_free(qr_cache *cache)
+{
+	qr_cache_entry *entry, *older;
+
+	for (entry = cache->newest; entry; entry = older)
+	{
+		older = entry->older;
+		free(entry);
+	}
+
+	free(cache->buckets);
+	pthread_mutex_destroy(&cache->lock);
+}
@@ -0,0 +1,42 @@
+#ifndef QR_CACHE_H
+#define QR_CACHE_H
+
+#include <pthread.h>
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct qr_cache_entry qr_cache_entry;
+
+struct qr_cache_entry
+{
+	uint64_t hash;
+	qr_cache_entry *chain;          // next entry of the same bucket
+	qr_cache_entry *newer, *older;  // recency list
+
+	size_t key_length, size;
+	unsigned pins;                  // readers writing the value out
+	int removed;                    // freed by the last reader if pinned
+	unsigned char data[];           // the key followed by the value
+};
+
+// least recently used entries are evicted once the entries take more than
+// the budget, all functions may be called from several threads
+typedef struct
+{
+	pthread_mutex_t lock;
+	size_t budget, used;
+
+	qr_cache_entry **buckets;
+	size_t bucket_count, count;
+	qr_cache_entry *newest, *oldest;
+
+	size_t hits, misses, evictions;
+} qr_cache;
+
+void qr_cache_init(qr_cache *cache, size_t budget);
+int qr_cache_get(qr_cache *cache, const void *key, size_t key_length, qr_sink *sink);
+void qr_cache_put(qr_cache *cache, const void *key, size_t key_length, const void *value, size_t size);
+void qr_cache_free(qr_cache *cache);
+
+#endif // QR_CACHE_H
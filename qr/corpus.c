@@ -0,0 +1,168 @@
+#include <fcntl.h>
+#include <qr/corpus.h>
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t
+get_uint(const unsigned char *bytes, size_t count)
+{
+	uint64_t value = 0;
+
+	while (count--)
+		value = (value << 8) | *bytes++;
+
+	return value;
+}
+
+// maps a whole file read-only, an empty file is not mapped
+static int
+map_file(const char *path, const unsigned char **data, size_t *size)
+{
+	struct stat info;
+	void *mapped;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return -1;
+
+	if (fstat(fd, &info) || !S_ISREG(info.st_mode))
+	{
+		close(fd);
+		return -1;
+	}
+
+	*data = NULL;
+	*size = info.st_size;
+	if (*size)
+	{
+		mapped = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED) *data = mapped;
+	}
+
+	close(fd);
+	return *size && !*data ? -1 : 0;
+}
+
+int
+qr_corpus_open(qr_corpus *corpus, const char *path)
+{
+	corpus->index = NULL;
+	corpus->index_size = 0;
+	corpus->offsets = NULL;
+	corpus->count = 0;
+
+	if (map_file(path, &corpus->data, &corpus->size))
+		return -1;
+
+	// records are mostly read front to back, even in several shards
+	if (corpus->data)
+		madvise((void *) corpus->data, corpus->size, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+// uses an index written by qr_corpus_put_index, its offsets are only checked
+// when a record is read
+int
+qr_corpus_open_index(qr_corpus *corpus, const char *path)
+{
+	if (map_file(path, &corpus->index, &corpus->index_size))
+		return -1;
+
+	if (corpus->index_size % QR_CORPUS_INDEX_ENTRY_SIZE)
+	{
+		munmap((void *) corpus->index, corpus->index_size);
+		corpus->index = NULL;
+		return -1;
+	}
+
+	corpus->count = corpus->index_size / QR_CORPUS_INDEX_ENTRY_SIZE;
+	return 0;
+}
+
+static uint64_t
+record_offset(const qr_corpus *corpus, size_t i)
+{
+	if (corpus->index)
+		return get_uint(corpus->index + i * QR_CORPUS_INDEX_ENTRY_SIZE, QR_CORPUS_INDEX_ENTRY_SIZE);
+	return corpus->offsets[i];
+}
+
+// finds the records by their lengths, fails if the last one is cut off or
+// the offsets do not fit into memory
+int
+qr_corpus_scan(qr_corpus *corpus)
+{
+	size_t offset, capacity = 0, *grown;
+
+	corpus->count = 0;
+	for (offset = 0; offset < corpus->size; offset += 4 + get_uint(corpus->data + offset, 4))
+	{
+		if (corpus->size - offset < 4 || corpus->size - offset - 4 < get_uint(corpus->data + offset, 4))
+			return -1;
+
+		if (corpus->count == capacity)
+		{
+			capacity = capacity ? 2 * capacity : 1024;
+			if (!(grown = realloc(corpus->offsets, capacity * sizeof(*corpus->offsets))))
+				return -1;
+			corpus->offsets = grown;
+		}
+		corpus->offsets[corpus->count++] = offset;
+	}
+
+	return 0;
+}
+
+// returns the payload of record i in the mapping, NULL if its offset or
+// length point outside of the file
+const char *
+qr_corpus_record(const qr_corpus *corpus, size_t i, size_t *length)
+{
+	uint64_t offset;
+
+	if (i >= corpus->count) return NULL;
+
+	offset = record_offset(corpus, i);
+	if (offset > corpus->size || corpus->size - offset < 4)
+		return NULL;
+
+	*length = get_uint(corpus->data + offset, 4);
+	if (corpus->size - offset - 4 < *length)
+		return NULL;
+
+	return (const char *) corpus->data + offset + 4;
+}
+
+void
+qr_corpus_put_index(const qr_corpus *corpus, qr_sink *sink)
+{
+	unsigned char entry[QR_CORPUS_INDEX_ENTRY_SIZE];
+	size_t i, j;
+	uint64_t offset;
+
+	for (i = 0; i < corpus->count; ++i)
+	{
+		offset = record_offset(corpus, i);
+		for (j = QR_CORPUS_INDEX_ENTRY_SIZE; j--; offset >>= 8)
+			entry[j] = offset & 0xFF;
+		qr_sink_put(sink, entry, sizeof(entry));
+	}
+}
+
+void
+qr_corpus_close(qr_corpus *corpus)
+{
+	if (corpus->data) munmap((void *) corpus->data, corpus->size);
+	if (corpus->index) munmap((void *) corpus->index, corpus->index_size);
+	free(corpus->offsets);
+
+	corpus->data = corpus->index = NULL;
+	corpus->offsets = NULL;
+	corpus->count = 0;
+}
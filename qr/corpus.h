@@ -0,0 +1,30 @@
+#ifndef QR_CORPUS_H
+#define QR_CORPUS_H
+
+#include <qr/sink.h>
+#include <stddef.h>
+
+#define QR_CORPUS_INDEX_ENTRY_SIZE 8
+
+// a mapped file of records of a 32-bit big endian length and the payload,
+// found through an index of 64-bit big endian offsets or by a scan
+typedef struct
+{
+	const unsigned char *data;
+	size_t size;
+
+	const unsigned char *index;  // mapped index file
+	size_t index_size;
+	size_t *offsets;             // or offsets found by qr_corpus_scan
+
+	size_t count;
+} qr_corpus;
+
+int qr_corpus_open(qr_corpus *corpus, const char *path);
+int qr_corpus_open_index(qr_corpus *corpus, const char *path);
+int qr_corpus_scan(qr_corpus *corpus);
+const char *qr_corpus_record(const qr_corpus *corpus, size_t i, size_t *length);
+void qr_corpus_put_index(const qr_corpus *corpus, qr_sink *sink);
+void qr_corpus_close(qr_corpus *corpus);
+
+#endif // QR_CORPUS_H
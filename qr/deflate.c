@@ -0,0 +1,607 @@
+#include <pthread.h>
+#include <qr/deflate.h>
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+#define MAX_CHAIN 32
+#define MAX_CHAIN_BEST 256
+#define MAX_LAZY 32  // longer matches are taken without looking one byte ahead
+#define END_OF_BLOCK 256
+
+#define LITERALS 286
+#define DISTANCES 30
+#define CODE_LENGTHS 19
+#define MAX_CODE_LENGTH 15
+#define MAX_CODE_LENGTH_LENGTH 7
+
+static const uint16_t LENGTH_BASE[29] =
+{
+	  3,   4,   5,   6,   7,   8,   9,  10,  11,  13,
+	 15,  17,  19,  23,  27,  31,  35,  43,  51,  59,
+	 67,  83,  99, 115, 131, 163, 195, 227, 258,
+};
+
+static const uint8_t LENGTH_EXTRA[29] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+	1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+	4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+static const uint16_t DISTANCE_BASE[30] =
+{
+	    1,     2,     3,     4,     5,     7,     9,    13,    17,    25,
+	   33,    49,    65,    97,   129,   193,   257,   385,   513,   769,
+	 1025,  1537,  2049,  3073,  4097,  6145,  8193, 12289, 16385, 24577,
+};
+
+static const uint8_t DISTANCE_EXTRA[30] =
+{
+	 0,  0,  0,  0,  1,  1,  2,  2,  3,  3,
+	 4,  4,  5,  5,  6,  6,  7,  7,  8,  8,
+	 9,  9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static const uint8_t CODE_LENGTH_ORDER[CODE_LENGTHS] =
+{
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void
+crc_build_table(void)
+{
+	uint32_t i, j, c;
+
+	for (i = 0; i < 256; ++i)
+	{
+		for (c = i, j = 0; j < 8; ++j)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		crc_table[i] = c;
+	}
+}
+
+uint32_t
+qr_crc32(uint32_t crc, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+
+	pthread_once(&crc_table_once, crc_build_table);
+
+	crc = ~crc;
+	while (size--)
+		crc = crc_table[(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+uint32_t
+qr_adler32(uint32_t adler, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+	size_t chunk;
+
+	while (size)
+	{
+		// largest run that cannot overflow b before the modulo
+		chunk = size < 5552 ? size : 5552;
+		size -= chunk;
+
+		while (chunk--)
+		{
+			a += *bytes++;
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+	}
+
+	return (b << 16) | a;
+}
+
+static void
+put_bits(qr_deflate *deflate, uint32_t value, unsigned count)
+{
+	deflate->bits |= value << deflate->bit_count;
+	deflate->bit_count += count;
+
+	while (deflate->bit_count >= 8)
+	{
+		qr_sink_putc(deflate->out, deflate->bits & 0xFF);
+		deflate->bits >>= 8;
+		deflate->bit_count -= 8;
+	}
+}
+
+// Huffman codes are stored starting with their most significant bit
+static void
+put_code(qr_deflate *deflate, uint32_t code, unsigned length)
+{
+	uint32_t reversed = 0;
+	unsigned i;
+
+	for (i = 0; i < length; ++i, code >>= 1)
+		reversed = (reversed << 1) | (code & 1);
+
+	put_bits(deflate, reversed, length);
+}
+
+static void
+put_symbol(qr_deflate *deflate, unsigned symbol)
+{
+	// fixed Huffman code of the literal/length alphabet
+	if (symbol < 144)      put_code(deflate, 0x30 + symbol, 8);
+	else if (symbol < 256) put_code(deflate, 0x190 + (symbol - 144), 9);
+	else if (symbol < 280) put_code(deflate, symbol - 256, 7);
+	else                   put_code(deflate, 0xC0 + (symbol - 280), 8);
+}
+
+static unsigned
+length_code(size_t length)
+{
+	unsigned code;
+
+	for (code = 28; LENGTH_BASE[code] > length; --code);
+	return code;
+}
+
+static unsigned
+distance_code(size_t distance)
+{
+	unsigned code;
+
+	for (code = 29; DISTANCE_BASE[code] > distance; --code);
+	return code;
+}
+
+static void
+put_match(qr_deflate *deflate, size_t length, size_t distance)
+{
+	unsigned code = length_code(length);
+
+	put_symbol(deflate, 257 + code);
+	put_bits(deflate, length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+	code = distance_code(distance);
+	put_code(deflate, code, 5);
+	put_bits(deflate, distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+}
+
+// Huffman code lengths of at most limit bits, shortest for the most frequent
+static void
+build_lengths(const uint32_t *frequencies, size_t n, unsigned limit, uint8_t *lengths)
+{
+	size_t symbols[LITERALS], parent[2 * LITERALS], count = 0, i, j, leaf, inner, node, pick;
+	uint32_t weight[2 * LITERALS], kraft;
+	unsigned depth[2 * LITERALS], per_length[MAX_CODE_LENGTH + 1] = {0};
+
+	memset(lengths, 0, n);
+
+	// used symbols by ascending frequency
+	for (i = 0; i < n; ++i)
+	{
+		if (!frequencies[i]) continue;
+		for (j = count++; j > 0 && frequencies[symbols[j - 1]] > frequencies[i]; --j)
+			symbols[j] = symbols[j - 1];
+		symbols[j] = i;
+	}
+
+	// a complete code needs at least two symbols
+	if (count < 2)
+	{
+		i = count ? symbols[0] : 0;
+		lengths[i] = 1;
+		lengths[i ? 0 : 1] = 1;
+		return;
+	}
+
+	// leaves and inner nodes are both created in ascending weight order
+	for (i = 0; i < count; ++i)
+		weight[i] = frequencies[symbols[i]];
+	for (leaf = 0, inner = node = count; node < 2 * count - 1; ++node)
+	{
+		for (j = 0; j < 2; ++j)
+		{
+			pick = leaf < count && (inner == node || weight[leaf] <= weight[inner]) ? leaf++ : inner++;
+			parent[pick] = node;
+			weight[node] = j ? weight[node] + weight[pick] : weight[pick];
+		}
+	}
+
+	depth[2 * count - 2] = 0;
+	for (i = 2 * count - 2; i-- > 0;)
+		depth[i] = depth[parent[i]] + 1;
+
+	// clamp to the limit, then lengthen codes until the Kraft sum fits
+	for (i = 0; i < count; ++i)
+		++per_length[depth[i] < limit ? depth[i] : limit];
+	for (kraft = 0, i = 1; i <= limit; ++i)
+		kraft += per_length[i] << (limit - i);
+	for (; kraft > 1u << limit; --kraft)
+	{
+		--per_length[limit];
+		for (i = limit - 1; i > 0; --i)
+		{
+			if (!per_length[i]) continue;
+			--per_length[i];
+			per_length[i + 1] += 2;
+			break;
+		}
+	}
+
+	for (i = 0, j = limit; j > 0; --j)
+		for (node = per_length[j]; node; --node)
+			lengths[symbols[i++]] = j;
+}
+
+static void
+build_codes(const uint8_t *lengths, size_t n, uint16_t *codes)
+{
+	uint16_t count[MAX_CODE_LENGTH + 1] = {0}, next[MAX_CODE_LENGTH + 1], code = 0;
+	size_t i;
+
+	for (i = 0; i < n; ++i)
+		++count[lengths[i]];
+	count[0] = 0;
+
+	for (i = 1; i <= MAX_CODE_LENGTH; ++i)
+		next[i] = code = (code + count[i - 1]) << 1;
+	for (i = 0; i < n; ++i)
+		if (lengths[i]) codes[i] = next[lengths[i]]++;
+}
+
+// writes the buffered tokens as a non-final dynamic Huffman block
+static void
+put_dynamic_block(qr_deflate *deflate)
+{
+	uint32_t literal_frequencies[LITERALS] = {0}, distance_frequencies[DISTANCES] = {0};
+	uint32_t run_frequencies[CODE_LENGTHS] = {0};
+	uint8_t literal_lengths[LITERALS], distance_lengths[DISTANCES], run_lengths[CODE_LENGTHS];
+	uint16_t literal_codes[LITERALS], distance_codes[DISTANCES], run_codes[CODE_LENGTHS];
+	uint8_t lengths[LITERALS + DISTANCES], runs[LITERALS + DISTANCES], run_extra[LITERALS + DISTANCES];
+	size_t literals, distances, run_count = 0, run, i;
+	unsigned code, value, distance, run_codes_used;
+
+	for (i = 0; i < deflate->token_count; ++i)
+	{
+		if (!deflate->token_distances[i])
+		{
+			++literal_frequencies[deflate->token_values[i]];
+			continue;
+		}
+		++literal_frequencies[257 + length_code(deflate->token_values[i])];
+		++distance_frequencies[distance_code(deflate->token_distances[i])];
+	}
+	++literal_frequencies[END_OF_BLOCK];
+
+	build_lengths(literal_frequencies, LITERALS, MAX_CODE_LENGTH, literal_lengths);
+	build_lengths(distance_frequencies, DISTANCES, MAX_CODE_LENGTH, distance_lengths);
+	build_codes(literal_lengths, LITERALS, literal_codes);
+	build_codes(distance_lengths, DISTANCES, distance_codes);
+
+	for (literals = LITERALS; !literal_lengths[literals - 1]; --literals);
+	for (distances = DISTANCES; !distance_lengths[distances - 1]; --distances);
+	memcpy(lengths, literal_lengths, literals);
+	memcpy(lengths + literals, distance_lengths, distances);
+
+	// run-length encoded code lengths, runs may cross into the distances
+	for (i = 0; i < literals + distances; i += run)
+	{
+		for (run = 1; i + run < literals + distances && lengths[i + run] == lengths[i]; ++run);
+
+		if (!lengths[i] && run >= 3)
+		{
+			if (run > 138) run = 138;
+			runs[run_count] = run <= 10 ? 17 : 18;
+			run_extra[run_count++] = run - (run <= 10 ? 3 : 11);
+		}
+		else if (lengths[i] && run >= 4)
+		{
+			// the length itself, then 3 to 6 repeats of it
+			if (run > 7) run = 7;
+			runs[run_count] = lengths[i];
+			run_extra[run_count++] = 0;
+			runs[run_count] = 16;
+			run_extra[run_count++] = run - 4;
+		}
+		else
+		{
+			run = 1;
+			runs[run_count] = lengths[i];
+			run_extra[run_count++] = 0;
+		}
+	}
+
+	for (i = 0; i < run_count; ++i)
+		++run_frequencies[runs[i]];
+	build_lengths(run_frequencies, CODE_LENGTHS, MAX_CODE_LENGTH_LENGTH, run_lengths);
+	build_codes(run_lengths, CODE_LENGTHS, run_codes);
+	for (run_codes_used = CODE_LENGTHS; run_codes_used > 4 && !run_lengths[CODE_LENGTH_ORDER[run_codes_used - 1]]; --run_codes_used);
+
+	put_bits(deflate, 0x4, 3);
+	put_bits(deflate, literals - 257, 5);
+	put_bits(deflate, distances - 1, 5);
+	put_bits(deflate, run_codes_used - 4, 4);
+	for (i = 0; i < run_codes_used; ++i)
+		put_bits(deflate, run_lengths[CODE_LENGTH_ORDER[i]], 3);
+
+	for (i = 0; i < run_count; ++i)
+	{
+		put_code(deflate, run_codes[runs[i]], run_lengths[runs[i]]);
+		if (runs[i] == 16) put_bits(deflate, run_extra[i], 2);
+		if (runs[i] == 17) put_bits(deflate, run_extra[i], 3);
+		if (runs[i] == 18) put_bits(deflate, run_extra[i], 7);
+	}
+
+	for (i = 0; i < deflate->token_count; ++i)
+	{
+		value = deflate->token_values[i];
+		distance = deflate->token_distances[i];
+		if (!distance)
+		{
+			put_code(deflate, literal_codes[value], literal_lengths[value]);
+			continue;
+		}
+
+		code = length_code(value);
+		put_code(deflate, literal_codes[257 + code], literal_lengths[257 + code]);
+		put_bits(deflate, value - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+		code = distance_code(distance);
+		put_code(deflate, distance_codes[code], distance_lengths[code]);
+		put_bits(deflate, distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+	}
+
+	put_code(deflate, literal_codes[END_OF_BLOCK], literal_lengths[END_OF_BLOCK]);
+	deflate->token_count = 0;
+}
+
+// fast mode writes symbols right away, best mode buffers a block of them
+static void
+emit(qr_deflate *deflate, size_t value, size_t distance)
+{
+	if (deflate->level == QR_DEFLATE_FAST)
+	{
+		if (distance) put_match(deflate, value, distance);
+		else put_symbol(deflate, value);
+		return;
+	}
+
+	deflate->token_values[deflate->token_count] = value;
+	deflate->token_distances[deflate->token_count] = distance;
+	if (++deflate->token_count == QR_DEFLATE_BLOCK_SIZE)
+		put_dynamic_block(deflate);
+}
+
+static inline size_t
+hash(const uint8_t *bytes)
+{
+	return ((bytes[0] << 10) ^ (bytes[1] << 5) ^ bytes[2]) & (QR_DEFLATE_HASH_SIZE - 1);
+}
+
+static void
+insert(qr_deflate *deflate, size_t position)
+{
+	size_t h = hash(deflate->window + position);
+
+	deflate->prev[position & (QR_DEFLATE_WINDOW_SIZE - 1)] = deflate->head[h];
+	deflate->head[h] = position;
+}
+
+static size_t
+match_length(const qr_deflate *deflate, size_t candidate, size_t limit)
+{
+	const uint8_t *window = deflate->window;
+	size_t length;
+
+	for (length = 0; length < limit && window[candidate + length] == window[deflate->position + length]; ++length);
+	return length;
+}
+
+static size_t
+longest_match(qr_deflate *deflate, size_t *distance)
+{
+	size_t limit = deflate->end - deflate->position, best = 0, length;
+	int32_t candidate = deflate->head[hash(deflate->window + deflate->position)];
+	unsigned chain = deflate->level == QR_DEFLATE_BEST ? MAX_CHAIN_BEST : MAX_CHAIN;
+
+	if (limit > MAX_MATCH) limit = MAX_MATCH;
+
+	// raster rows repeat at a fixed distance that runs of equal bytes hide
+	// from the hash chain, so the previous distance is tried first
+	if (deflate->distance && deflate->distance <= deflate->position)
+	{
+		best = match_length(deflate, deflate->position - deflate->distance, limit);
+		*distance = deflate->distance;
+		if (best == limit) return best;
+	}
+
+	for (; candidate >= 0 && chain--; candidate = deflate->prev[candidate & (QR_DEFLATE_WINDOW_SIZE - 1)])
+	{
+		if (deflate->position - candidate > QR_DEFLATE_WINDOW_SIZE) break;
+
+		length = match_length(deflate, candidate, limit);
+		if (length > best)
+		{
+			best = length;
+			*distance = deflate->position - candidate;
+			if (best == limit) break;
+		}
+	}
+
+	return best;
+}
+
+// encodes everything but the last lookahead bytes unless finishing
+static void
+compress(qr_deflate *deflate, int finish)
+{
+	size_t length, distance = 0, next_distance = 0, i;
+
+	while (deflate->end - deflate->position >= (finish ? 1 : MAX_MATCH))
+	{
+		if (deflate->end - deflate->position < MIN_MATCH)
+		{
+			emit(deflate, deflate->window[deflate->position++], 0);
+			continue;
+		}
+
+		length = longest_match(deflate, &distance);
+		insert(deflate, deflate->position);
+
+		// a longer match starting at the next byte is worth a literal
+		if (deflate->level == QR_DEFLATE_BEST && length >= MIN_MATCH && length < MAX_LAZY
+			&& deflate->end - deflate->position > MIN_MATCH)
+		{
+			++deflate->position;
+			if (longest_match(deflate, &next_distance) > length)
+				length = 0;
+			--deflate->position;
+		}
+
+		if (length < MIN_MATCH)
+		{
+			emit(deflate, deflate->window[deflate->position++], 0);
+			continue;
+		}
+
+		emit(deflate, length, distance);
+		deflate->distance = distance;
+		for (i = 1, ++deflate->position; i < length; ++i, ++deflate->position)
+			if (deflate->end - deflate->position >= MIN_MATCH)
+				insert(deflate, deflate->position);
+	}
+}
+
+static void
+slide(qr_deflate *deflate)
+{
+	size_t i;
+
+	memmove(deflate->window, deflate->window + QR_DEFLATE_WINDOW_SIZE, QR_DEFLATE_WINDOW_SIZE);
+	deflate->position -= QR_DEFLATE_WINDOW_SIZE;
+	deflate->end -= QR_DEFLATE_WINDOW_SIZE;
+
+	for (i = 0; i < QR_DEFLATE_HASH_SIZE; ++i)
+		deflate->head[i] = deflate->head[i] >= QR_DEFLATE_WINDOW_SIZE ? deflate->head[i] - QR_DEFLATE_WINDOW_SIZE : -1;
+	for (i = 0; i < QR_DEFLATE_WINDOW_SIZE; ++i)
+		deflate->prev[i] = deflate->prev[i] >= QR_DEFLATE_WINDOW_SIZE ? deflate->prev[i] - QR_DEFLATE_WINDOW_SIZE : -1;
+}
+
+static void
+put_uint32_be(qr_sink *sink, uint32_t value)
+{
+	uint8_t bytes[4] = { value >> 24, value >> 16, value >> 8, value };
+	qr_sink_put(sink, bytes, 4);
+}
+
+static void
+put_uint32_le(qr_sink *sink, uint32_t value)
+{
+	uint8_t bytes[4] = { value, value >> 8, value >> 16, value >> 24 };
+	qr_sink_put(sink, bytes, 4);
+}
+
+void
+qr_deflate_init(qr_deflate *deflate, qr_deflate_format format, qr_deflate_level level, qr_sink *out)
+{
+	deflate->out = out;
+	deflate->format = format;
+	deflate->level = level;
+	deflate->checksum = format == QR_DEFLATE_ZLIB ? 1 : 0;
+	deflate->size = 0;
+	deflate->bits = 0;
+	deflate->bit_count = 0;
+	deflate->position = 0;
+	deflate->end = 0;
+	deflate->distance = 0;
+	deflate->token_count = 0;
+	memset(deflate->head, 0xFF, sizeof(deflate->head));
+
+	// deflate with a 32K window, compression level as a hint for readers
+	if (format == QR_DEFLATE_ZLIB)
+		qr_sink_put(out, level == QR_DEFLATE_BEST ? "\x78\xDA" : "\x78\x01", 2);
+
+	// no name, no modification time, unknown operating system
+	if (format == QR_DEFLATE_GZIP)
+		qr_sink_put(out, level == QR_DEFLATE_BEST ? "\x1F\x8B\x08\0\0\0\0\0\x02\xFF" : "\x1F\x8B\x08\0\0\0\0\0\x04\xFF", 10);
+
+	// fast mode writes the whole stream as a single non-final fixed Huffman block
+	if (level == QR_DEFLATE_FAST)
+		put_bits(deflate, 0x2, 3);
+}
+
+void
+qr_deflate_write(qr_deflate *deflate, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	size_t chunk;
+
+	if (deflate->format == QR_DEFLATE_ZLIB)
+		deflate->checksum = qr_adler32(deflate->checksum, data, size);
+	if (deflate->format == QR_DEFLATE_GZIP)
+		deflate->checksum = qr_crc32(deflate->checksum, data, size);
+	deflate->size += size;
+
+	while (size)
+	{
+		if (deflate->end == sizeof(deflate->window))
+			slide(deflate);
+
+		chunk = sizeof(deflate->window) - deflate->end;
+		if (chunk > size) chunk = size;
+
+		memcpy(deflate->window + deflate->end, bytes, chunk);
+		deflate->end += chunk;
+		bytes += chunk;
+		size -= chunk;
+
+		compress(deflate, 0);
+	}
+}
+
+void
+qr_deflate_finish(qr_deflate *deflate)
+{
+	compress(deflate, 1);
+	if (deflate->level == QR_DEFLATE_FAST)
+		put_symbol(deflate, END_OF_BLOCK);
+	else if (deflate->token_count)
+		put_dynamic_block(deflate);
+
+	// empty final block, then pad to a byte boundary
+	put_bits(deflate, 0x3, 3);
+	put_symbol(deflate, END_OF_BLOCK);
+	if (deflate->bit_count)
+		put_bits(deflate, 0, 8 - deflate->bit_count);
+
+	if (deflate->format == QR_DEFLATE_ZLIB)
+		put_uint32_be(deflate->out, deflate->checksum);
+
+	if (deflate->format == QR_DEFLATE_GZIP)
+	{
+		put_uint32_le(deflate->out, deflate->checksum);
+		put_uint32_le(deflate->out, deflate->size);
+	}
+}
+
+static size_t
+sink_write(void *context, const void *data, size_t size)
+{
+	qr_deflate_write(context, data, size);
+	return size;
+}
+
+void
+qr_deflate_sink(qr_sink *sink, qr_deflate *deflate)
+{
+	qr_sink_init(sink, sink_write, deflate);
+}
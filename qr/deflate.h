@@ -0,0 +1,60 @@
+#ifndef QR_DEFLATE_H
+#define QR_DEFLATE_H
+
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define QR_DEFLATE_WINDOW_SIZE 32768
+#define QR_DEFLATE_HASH_SIZE   16384
+#define QR_DEFLATE_BLOCK_SIZE  16384  // tokens per dynamic Huffman block
+
+typedef enum
+{
+	QR_DEFLATE_RAW,
+	QR_DEFLATE_ZLIB,
+	QR_DEFLATE_GZIP,
+} qr_deflate_format;
+
+typedef enum
+{
+	QR_DEFLATE_FAST,  // fixed Huffman codes, greedy matching
+	QR_DEFLATE_BEST,  // dynamic Huffman codes, lazy matching, longer chains
+} qr_deflate_level;
+
+typedef struct
+{
+	qr_sink *out;
+	qr_deflate_format format;
+	qr_deflate_level level;
+	uint32_t checksum;
+	uint32_t size;  // of the input, modulo 2^32
+
+	uint32_t bits;
+	unsigned bit_count;
+
+	// input is kept until it has left the match window
+	size_t position;
+	size_t end;
+	size_t distance;  // of the previous match
+	uint8_t window[2 * QR_DEFLATE_WINDOW_SIZE];
+	int32_t head[QR_DEFLATE_HASH_SIZE];
+	int32_t prev[QR_DEFLATE_WINDOW_SIZE];
+
+	// literals have a zero distance, matches store their length
+	size_t token_count;
+	uint16_t token_values[QR_DEFLATE_BLOCK_SIZE];
+	uint16_t token_distances[QR_DEFLATE_BLOCK_SIZE];
+} qr_deflate;
+
+uint32_t qr_crc32(uint32_t crc, const void *data, size_t size);
+uint32_t qr_adler32(uint32_t adler, const void *data, size_t size);
+
+void qr_deflate_init(qr_deflate *deflate, qr_deflate_format format, qr_deflate_level level, qr_sink *out);
+void qr_deflate_write(qr_deflate *deflate, const void *data, size_t size);
+void qr_deflate_finish(qr_deflate *deflate);
+
+// everything written to the sink is compressed into the deflate stream
+void qr_deflate_sink(qr_sink *sink, qr_deflate *deflate);
+
+#endif // QR_DEFLATE_H
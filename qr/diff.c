@@ -0,0 +1,154 @@
+#include <assert.h>
+#include <qr/diff.h>
+#include <qr/rects.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROW_WORDS 3     // 64-bit words of a module row of a version 40 symbol
+#define MAX_ROW_RUNS 177  // changed runs of both states in one module row
+
+// bit j of the row is set for a dark module in column j
+static void
+pack_row(const qr_code *qr, size_t i, uint64_t words[ROW_WORDS])
+{
+	const int *row = qr->matrix + i * qr->side_length;
+	size_t j;
+
+	memset(words, 0, ROW_WORDS * sizeof(*words));
+	for (j = 0; j < qr->side_length; ++j)
+		if (row[j]) words[j / 64] |= (uint64_t) 1 << (j % 64);
+}
+
+static size_t
+next_set_bit(const uint64_t words[ROW_WORDS], size_t j, size_t n)
+{
+	while (j < n && !(words[j / 64] >> (j % 64)))
+		j = (j / 64 + 1) * 64;
+	while (j < n && !((words[j / 64] >> (j % 64)) & 1))
+		++j;
+
+	return j < n ? j : n;
+}
+
+static size_t
+next_clear_bit(const uint64_t words[ROW_WORDS], size_t j, size_t n)
+{
+	while (j < n && ((words[j / 64] >> (j % 64)) & 1))
+		++j;
+
+	return j;
+}
+
+// covers the modules whose state differs with rectangles of one new state:
+// every row is compared with an XOR of its packed words, the runs of
+// changed modules then extend the equal runs of the row above
+qr_diff_rect *
+qr_diff(const qr_code *previous, const qr_code *next, size_t *count)
+{
+	size_t n = next->side_length, capacity = 64, i, j, end, k, w, open_count = 0, row_count;
+	size_t open[MAX_ROW_RUNS], row[MAX_ROW_RUNS];
+	uint64_t before[ROW_WORDS], after[ROW_WORDS], changed[2][ROW_WORDS];
+	qr_diff_rect *rects = malloc(capacity * sizeof(*rects)), *grown;
+	int dark;
+
+	assert(previous->side_length == next->side_length);
+
+	*count = 0;
+	for (i = 0; i < n; ++i)
+	{
+		pack_row(previous, i, before);
+		pack_row(next, i, after);
+		for (w = 0; w < ROW_WORDS; ++w)
+		{
+			changed[0][w] = (before[w] ^ after[w]) & ~after[w];
+			changed[1][w] = (before[w] ^ after[w]) & after[w];
+		}
+
+		row_count = 0;
+		for (dark = 0; dark < 2; ++dark)
+		{
+			for (j = next_set_bit(changed[dark], 0, n); j < n; j = next_set_bit(changed[dark], end, n))
+			{
+				end = next_clear_bit(changed[dark], j, n);
+
+				// the same run in the row above grows downwards
+				for (k = 0; k < open_count; ++k)
+				{
+					qr_diff_rect *rect = &rects[open[k]];
+					if (rect->dark == dark && rect->rect.x == j && rect->rect.width == end - j)
+						break;
+				}
+				if (k < open_count)
+				{
+					++rects[open[k]].rect.height;
+					row[row_count++] = open[k];
+					continue;
+				}
+
+				if (*count == capacity)
+				{
+					if (!(grown = realloc(rects, 2 * capacity * sizeof(*rects))))
+					{
+						free(rects);
+						*count = 0;
+						return NULL;
+					}
+					rects = grown;
+					capacity *= 2;
+				}
+
+				rects[*count] = (qr_diff_rect) { { j, i, end - j, 1 }, dark };
+				row[row_count++] = (*count)++;
+			}
+		}
+
+		memcpy(open, row, row_count * sizeof(*row));
+		open_count = row_count;
+	}
+
+	return rects;
+}
+
+// one line per rectangle: column, row, width, height and the new state,
+// 1 for dark and 0 for light
+void
+qr_diff_render_text(const qr_diff_rect *rects, size_t count, qr_sink *sink)
+{
+	size_t k;
+
+	for (k = 0; k < count; ++k)
+	{
+		qr_sink_put_uint(sink, rects[k].rect.x);
+		qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, rects[k].rect.y);
+		qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, rects[k].rect.width);
+		qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, rects[k].rect.height);
+		qr_sink_puts(sink, rects[k].dark ? " 1\n" : " 0\n");
+	}
+}
+
+// the number of rectangles as a big endian 32-bit integer, then five bytes
+// per rectangle, which all fit as a symbol is at most 177 modules wide
+void
+qr_diff_render_binary(const qr_diff_rect *rects, size_t count, qr_sink *sink)
+{
+	uint8_t bytes[5] = { count >> 24, count >> 16, count >> 8, count };
+	size_t k;
+
+	qr_sink_put(sink, bytes, 4);
+	for (k = 0; k < count; ++k)
+	{
+		bytes[0] = rects[k].rect.x;
+		bytes[1] = rects[k].rect.y;
+		bytes[2] = rects[k].rect.width;
+		bytes[3] = rects[k].rect.height;
+		bytes[4] = rects[k].dark;
+		qr_sink_put(sink, bytes, 5);
+	}
+}
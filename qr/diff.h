@@ -0,0 +1,19 @@
+#ifndef QR_DIFF_H
+#define QR_DIFF_H
+
+#include <qr/rects.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+
+typedef struct
+{
+	qr_rect rect;
+	int dark;  // new state of every module in the rectangle
+} qr_diff_rect;
+
+qr_diff_rect *qr_diff(const qr_code *previous, const qr_code *next, size_t *count);
+void qr_diff_render_text(const qr_diff_rect *rects, size_t count, qr_sink *sink);
+void qr_diff_render_binary(const qr_diff_rect *rects, size_t count, qr_sink *sink);
+
+#endif // QR_DIFF_H
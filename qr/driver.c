@@ -0,0 +1,647 @@
+#include <qr/append.h>
+#include <qr/batch.h>
+#include <qr/cache.h>
+#include <qr/corpus.h>
+#include <qr/driver.h>
+#include <qr/input.h>
+#include <qr/output.h>
+#include <qr/pool.h>
+#include <qr/qr.h>
+#include <qr/sink.h>
+#include <qr/store.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+extern void log_(const char *fmt, ...);
+
+#define BATCH_WINDOW 64  // records queued per worker
+
+// the sequence numbers of the records queued for a worker, the reader
+// pushes to the back, the owner takes from the front and idle workers
+// steal from the back
+typedef struct
+{
+	pthread_mutex_t lock;
+	size_t *numbers;  // ring of one entry per slot
+	size_t first, last;
+} batch_deque;
+
+typedef struct
+{
+	qr_code *symbol;           // encoded again for every record
+	qr_output_options output;  // with its own deflate state
+	qr_buffer key;             // of the record in the cache
+	batch_deque queue;
+} batch_worker;
+
+// a record of the queue from the time it is read until its output is
+// written, records take the slot of their sequence number modulo the slot
+// count
+typedef struct
+{
+	const char *input;
+	size_t length, number;
+	qr_buffer record;    // copy of a delimited record
+	qr_buffer rendered;  // output written to stdout or kept in the cache
+	size_t size;
+	int status;
+	int done;            // encoded in input order, written otherwise
+} batch_slot;
+
+// a bounded window of records between the reader thread and the workers.
+// records are read and retired in sequence, a slot is only read again once
+// its record is retired. in between, the reader pushes them round-robin to
+// the deques of the workers, from where any idle worker may take them. in
+// input order the worker that finds the oldest records done writes them
+// outside of the lock, as they complete every worker writes its own under
+// the output lock
+typedef struct
+{
+	const qr_driver_options *options;
+	const qr_input_options *encode;
+	qr_format format;
+	const qr_raster_options *raster;
+	const char *pattern;
+	batch_worker *workers;
+	unsigned worker_count;
+	qr_cache *cache;
+
+	// records come from a delimited stream or a mapped corpus
+	qr_batch_reader *reader;
+	const qr_corpus *corpus;
+	size_t read;
+
+	batch_slot *slots;
+	size_t slot_count;
+
+	pthread_mutex_t lock;
+	pthread_cond_t filled, space;
+	size_t head, retired;  // sequence numbers of the next records
+	int end, writing;
+	size_t failed;
+
+	pthread_mutex_t output_lock;  // records written as they complete
+	qr_sink out;
+	qr_sink manifest;
+} batch_context;
+
+// renders one record into its own file or, without a pattern, into its
+// slot. with a cache the output is always rendered into the slot, or taken
+// from the cache if qr is NULL, and the file is written from there
+static int
+write_record(const qr_code *qr, batch_slot *slot, batch_context *batch, batch_worker *own)
+{
+	const qr_output_options *output = &own->output;
+	qr_buffer *rendered = &slot->rendered;
+	qr_output_sink out;
+	char *path;
+	size_t length;
+	FILE *file;
+	int status;
+
+	if (qr && (!output->path || batch->cache))
+	{
+		qr_sink_memory(&out.base, rendered);
+		qr_render(qr, batch->format, batch->raster, qr_output_wrap(&out, output));
+		if ((status = qr_output_end(&out)))
+			return status;
+		if (batch->cache)
+			qr_cache_put(batch->cache, own->key.data, own->key.length, rendered->data, rendered->length);
+	}
+
+	slot->size = rendered->length;
+	if (!output->path)
+		return 0;
+
+	length = qr_batch_path(output->path, slot->number, NULL, 0) + 1;
+	path = malloc(length);
+	qr_batch_path(output->path, slot->number, path, length);
+
+	if (!(file = fopen(path, "wb")))
+	{
+		log_("Error: Could not open output file %s\n", path);
+		free(path);
+		return -1;
+	}
+
+	if (batch->cache)
+	{
+		status = fwrite(rendered->data, 1, rendered->length, file) != rendered->length;
+		status |= fclose(file);
+	}
+	else
+	{
+		qr_render(qr, batch->format, batch->raster, qr_output_begin(&out, file, output));
+		status = qr_output_end(&out) | fclose(file);
+		slot->size = out.base.written;
+	}
+	if (status)
+		log_("Error: Could not write output file %s\n", path);
+
+	free(path);
+	return status;
+}
+
+// the payload and every option that changes the output
+static void
+make_key(batch_context *batch, batch_worker *own, const batch_slot *slot)
+{
+	const long settings[] = { batch->format, batch->raster->scale, batch->raster->quiet_zone, own->output.gzip ? (long) own->output.level : -1 };
+	qr_sink sink;
+
+	own->key.length = 0;
+	qr_sink_memory(&sink, &own->key);
+	qr_input_put_settings(&sink, batch->encode);
+	qr_sink_put(&sink, settings, sizeof(settings));
+	qr_sink_put(&sink, slot->input, slot->length);
+	qr_sink_flush(&sink);
+}
+
+// writes the cached output of a record into its slot
+static int
+get_cached(batch_context *batch, batch_worker *own, batch_slot *slot)
+{
+	qr_sink sink;
+	int found;
+
+	make_key(batch, own, slot);
+	qr_sink_memory(&sink, &slot->rendered);
+	found = qr_cache_get(batch->cache, own->key.data, own->key.length, &sink);
+	qr_sink_flush(&sink);
+
+	return found;
+}
+
+// called by the only writer of the moment. stdout gets the output as a
+// record, an empty one if it failed, with its record number if the order
+// or the shard does not tell it. the manifest gets a line of the record
+// number, the size and the file or the offset in stdout
+static void
+put_record(batch_context *batch, const batch_slot *slot)
+{
+	size_t size = slot->status ? 0 : slot->size;
+	int numbered = !batch->options->ordered || batch->options->shard_count > 1;
+	size_t offset = batch->out.written + (numbered ? 8 : 4), length;
+	char *path;
+
+	if (!batch->pattern && numbered)
+		qr_batch_put_numbered_record(&batch->out, slot->number, slot->rendered.data, size);
+	else if (!batch->pattern)
+		qr_batch_put_record(&batch->out, slot->rendered.data, size);
+
+	if (!batch->options->manifest)
+		return;
+
+	qr_sink_put_uint(&batch->manifest, slot->number);
+	qr_sink_putc(&batch->manifest, ' ');
+	qr_sink_put_uint(&batch->manifest, size);
+	qr_sink_putc(&batch->manifest, ' ');
+
+	if (slot->status)
+	{
+		qr_sink_puts(&batch->manifest, "failed");
+	}
+	else if (batch->pattern)
+	{
+		length = qr_batch_path(batch->pattern, slot->number, NULL, 0) + 1;
+		path = malloc(length);
+		qr_batch_path(batch->pattern, slot->number, path, length);
+		qr_sink_puts(&batch->manifest, path);
+		free(path);
+	}
+	else
+	{
+		qr_sink_put_uint(&batch->manifest, offset);
+	}
+
+	qr_sink_putc(&batch->manifest, '\n');
+}
+
+static int
+encode_record(batch_context *batch, batch_worker *own, batch_slot *slot)
+{
+	qr_code *symbols[QR_APPEND_MAX_SYMBOLS];
+
+	slot->rendered.length = 0;
+	if (!slot->input)
+		log_("Error: Record %zu is outside of the corpus\n", slot->number);
+	else if (batch->cache && get_cached(batch, own, slot))
+		return write_record(NULL, slot, batch, own);
+	else if (qr_input_encode(slot->input, slot->length, batch->encode, own->symbol, symbols))
+		return write_record(own->symbol, slot, batch, own);
+	else
+		log_("Error: Record %zu was not encoded\n", slot->number);
+
+	return -1;
+}
+
+// called with the lock held. frees the slots of the oldest records before
+// last that are done and wakes the reader
+static void
+retire_done(batch_context *batch, size_t last)
+{
+	batch_slot *slot;
+	size_t start = batch->retired;
+
+	for (; batch->retired < last && (slot = &batch->slots[batch->retired % batch->slot_count])->done; ++batch->retired)
+		slot->done = 0;
+
+	if (batch->retired != start)
+		pthread_cond_signal(&batch->space);
+}
+
+// called with the lock held. unless another worker is writing, writes the
+// oldest records that are done in input order, with the lock released
+static void
+write_ordered(batch_context *batch)
+{
+	size_t first, last;
+
+	if (batch->writing)
+		return;
+
+	batch->writing = 1;
+	for (first = batch->retired; first < batch->head && batch->slots[first % batch->slot_count].done; first = batch->retired)
+	{
+		for (last = first; last < batch->head && batch->slots[last % batch->slot_count].done; ++last);
+
+		pthread_mutex_unlock(&batch->lock);
+		for (; first < last; ++first)
+			put_record(batch, &batch->slots[first % batch->slot_count]);
+		pthread_mutex_lock(&batch->lock);
+
+		retire_done(batch, last);
+	}
+	batch->writing = 0;
+}
+
+// called with the lock held, the deque of a record is chosen by its number
+static void
+push_record(batch_context *batch, size_t number)
+{
+	batch_deque *deque = &batch->workers[number % batch->worker_count].queue;
+
+	pthread_mutex_lock(&deque->lock);
+	deque->numbers[deque->last++ % batch->slot_count] = number;
+	pthread_mutex_unlock(&deque->lock);
+}
+
+// takes the oldest record of the worker's own deque or steals the newest
+// of the next deque that is not empty
+static int
+take_record(batch_context *batch, unsigned worker, size_t *number)
+{
+	batch_deque *deque;
+	unsigned i;
+	int found = 0;
+
+	for (i = 0; i < batch->worker_count && !found; ++i)
+	{
+		deque = &batch->workers[(worker + i) % batch->worker_count].queue;
+
+		pthread_mutex_lock(&deque->lock);
+		if ((found = deque->first < deque->last))
+			*number = deque->numbers[(i ? --deque->last : deque->first++) % batch->slot_count];
+		pthread_mutex_unlock(&deque->lock);
+	}
+
+	return found;
+}
+
+// takes records from the deques until the reader has reached the end and
+// every record is taken
+static void
+encode_records(void *context, unsigned worker, size_t job)
+{
+	batch_context *batch = context;
+	batch_worker *own = &batch->workers[worker];
+	batch_slot *slot;
+	size_t pushed, number;
+	int end, status;
+
+	(void) job;
+	pthread_mutex_lock(&batch->lock);
+	for (;;)
+	{
+		// every record pushed before is in a deque, a later one moves the head
+		pushed = batch->head;
+		end = batch->end;
+		pthread_mutex_unlock(&batch->lock);
+
+		if (!take_record(batch, worker, &number))
+		{
+			pthread_mutex_lock(&batch->lock);
+			if (end)
+				break;
+			while (batch->head == pushed && !batch->end)
+				pthread_cond_wait(&batch->filled, &batch->lock);
+			continue;
+		}
+
+		slot = &batch->slots[number % batch->slot_count];
+		slot->status = status = encode_record(batch, own, slot);
+		if (!batch->options->ordered)
+		{
+			pthread_mutex_lock(&batch->output_lock);
+			put_record(batch, slot);
+			pthread_mutex_unlock(&batch->output_lock);
+		}
+
+		pthread_mutex_lock(&batch->lock);
+		batch->failed += !!status;
+		slot->done = 1;
+		if (batch->options->ordered)
+			write_ordered(batch);
+		else
+			retire_done(batch, batch->head);
+	}
+	pthread_mutex_unlock(&batch->lock);
+}
+
+// records are assigned by their number or their payload, a corpus record
+// outside of the file is reported by the first shard
+static int
+in_shard(const batch_context *batch, size_t number, const char *input, size_t length)
+{
+	const qr_driver_options *options = batch->options;
+
+	if (options->shard_by_hash && !input)
+		return options->shard == 1;
+	return qr_batch_shard(number, input, length, options->shard_count, options->shard_by_hash) == options->shard;
+}
+
+// reads the next record of the shard into slot, returns 0 at the end.
+// records of a corpus are used in place, delimited ones are copied
+static int
+read_record(batch_context *batch, batch_slot *slot)
+{
+	const char *input;
+	size_t length = 0;
+	qr_sink sink;
+
+	if (batch->corpus)
+	{
+		for (; batch->read < batch->corpus->count; ++batch->read)
+		{
+			// records of other shards by number are not even touched
+			if (!batch->options->shard_by_hash && !in_shard(batch, batch->read + 1, NULL, 0))
+				continue;
+
+			input = qr_corpus_record(batch->corpus, batch->read, &length);
+			if (!in_shard(batch, batch->read + 1, input, length))
+				continue;
+
+			slot->number = ++batch->read;
+			slot->input = input;
+			slot->length = length;
+			return 1;
+		}
+
+		return 0;
+	}
+
+	while (qr_batch_next(batch->reader, &length))
+	{
+		if (!in_shard(batch, ++batch->read, batch->reader->record, length))
+			continue;
+
+		slot->record.length = 0;
+		qr_sink_memory(&sink, &slot->record);
+		qr_sink_put(&sink, batch->reader->record, length);
+		qr_sink_flush(&sink);
+
+		slot->number = batch->read;
+		slot->input = slot->record.data ? slot->record.data : "";
+		slot->length = length;
+		return 1;
+	}
+
+	return 0;
+}
+
+// fills the free slots of the window and pushes every record as soon as it
+// is read
+static void *
+read_records(void *context)
+{
+	batch_context *batch = context;
+	batch_slot *slot;
+
+	pthread_mutex_lock(&batch->lock);
+	for (;;)
+	{
+		while (batch->head - batch->retired == batch->slot_count)
+			pthread_cond_wait(&batch->space, &batch->lock);
+
+		slot = &batch->slots[batch->head % batch->slot_count];
+		pthread_mutex_unlock(&batch->lock);
+
+		if (!read_record(batch, slot))
+			break;
+
+		pthread_mutex_lock(&batch->lock);
+		push_record(batch, batch->head++);
+		pthread_cond_signal(&batch->filled);
+	}
+
+	pthread_mutex_lock(&batch->lock);
+	batch->end = 1;
+	pthread_cond_broadcast(&batch->filled);
+	pthread_mutex_unlock(&batch->lock);
+
+	return NULL;
+}
+
+// encodes the records of reader or corpus on a pool of workers while a
+// thread reads ahead, a failed record is reported and skipped, records are
+// numbered from 1 in file names and messages
+static int
+write_batch(qr_batch_reader *reader, const qr_corpus *corpus, const qr_driver_options *options, qr_input_options *encode, qr_format format, const qr_raster_options *raster, const qr_output_options *output)
+{
+	batch_context batch = { .options = options, .encode = encode, .format = format, .raster = raster, .pattern = output->path, .reader = reader, .corpus = corpus };
+	size_t i;
+	unsigned threads;
+	pthread_t reading;
+	FILE *manifest = NULL;
+	qr_cache cache;
+	qr_pool pool;
+	int status;
+
+	if (options->manifest && !(manifest = fopen(options->manifest, "wb")))
+	{
+		log_("Error: Could not open manifest %s\n", options->manifest);
+		return -1;
+	}
+
+	// records are encoded in parallel instead of their blocks
+	encode->split = 0;
+	encode->quiet = 1;
+	encode->ec_pool = NULL;
+	threads = qr_pool_init(&pool, options->threads);
+	if (options->cache_size)
+		qr_cache_init(batch.cache = &cache, options->cache_size);
+
+	batch.slot_count = threads * BATCH_WINDOW;
+	batch.worker_count = threads;
+	batch.workers = malloc(threads * sizeof(*batch.workers));
+	for (i = 0; i < threads; ++i)
+	{
+		batch.workers[i].symbol = qr_create(encode->level, encode->mode, 0);
+		batch.workers[i].key = (qr_buffer) { 0 };
+		batch.workers[i].output = *output;
+		if (output->gzip) batch.workers[i].output.gzip = malloc(sizeof(*output->gzip));
+		pthread_mutex_init(&batch.workers[i].queue.lock, NULL);
+		batch.workers[i].queue.numbers = malloc(batch.slot_count * sizeof(*batch.workers[i].queue.numbers));
+		batch.workers[i].queue.first = batch.workers[i].queue.last = 0;
+	}
+
+	batch.slots = calloc(batch.slot_count, sizeof(*batch.slots));
+	pthread_mutex_init(&batch.lock, NULL);
+	pthread_mutex_init(&batch.output_lock, NULL);
+	pthread_cond_init(&batch.filled, NULL);
+	pthread_cond_init(&batch.space, NULL);
+	qr_sink_file(&batch.out, options->out);
+	if (manifest) qr_sink_file(&batch.manifest, manifest);
+
+	if ((status = pthread_create(&reading, NULL, read_records, &batch)))
+	{
+		log_("Error: Could not start the batch reader\n");
+	}
+	else
+	{
+		qr_pool_run(&pool, threads, encode_records, &batch);
+		pthread_join(reading, NULL);
+
+		if (options->shard_count > 1)
+			log_("Encoded %zu of %zu records in shard %u of %u\n", batch.head - batch.failed, batch.head, options->shard, options->shard_count);
+		else
+			log_("Encoded %zu of %zu records\n", batch.head - batch.failed, batch.head);
+		if (batch.cache)
+			log_("Cache: %zu hits, %zu misses, %zu evictions, %zu of %zu bytes used\n", cache.hits, cache.misses, cache.evictions, cache.used, cache.budget);
+		if (encode->store)
+			log_("Symbol store: %zu hits, %zu misses\n", encode->store->hits, encode->store->misses);
+	}
+
+	if (qr_sink_flush(&batch.out))
+	{
+		log_("Error: Could not write output\n");
+		status = -1;
+	}
+	if (manifest && (qr_sink_flush(&batch.manifest) | fclose(manifest)))
+	{
+		log_("Error: Could not write manifest %s\n", options->manifest);
+		status = -1;
+	}
+
+	qr_pool_destroy(&pool);
+	if (batch.cache) qr_cache_free(&cache);
+	for (i = 0; i < threads; ++i)
+	{
+		qr_destroy(batch.workers[i].symbol);
+		qr_buffer_free(&batch.workers[i].key);
+		free(batch.workers[i].output.gzip);
+		pthread_mutex_destroy(&batch.workers[i].queue.lock);
+		free(batch.workers[i].queue.numbers);
+	}
+	for (i = 0; i < batch.slot_count; ++i)
+	{
+		qr_buffer_free(&batch.slots[i].record);
+		qr_buffer_free(&batch.slots[i].rendered);
+	}
+	pthread_mutex_destroy(&batch.lock);
+	pthread_mutex_destroy(&batch.output_lock);
+	pthread_cond_destroy(&batch.filled);
+	pthread_cond_destroy(&batch.space);
+	free(batch.workers);
+	free(batch.slots);
+
+	return status || batch.failed ? -1 : 0;
+}
+
+// maps a corpus and its index, an index that does not exist yet is written
+// after the records are found by a scan
+static int
+open_corpus(qr_corpus *corpus, const char *path, const char *index)
+{
+	qr_sink sink;
+	FILE *file;
+
+	if (qr_corpus_open(corpus, path))
+	{
+		log_("Error: Could not map corpus %s\n", path);
+		return -1;
+	}
+
+	if (index && !access(index, F_OK))
+	{
+		if (!qr_corpus_open_index(corpus, index))
+			return 0;
+		log_("Error: Invalid corpus index %s\n", index);
+		qr_corpus_close(corpus);
+		return -1;
+	}
+
+	if (qr_corpus_scan(corpus))
+	{
+		log_("Error: Could not scan corpus %s, its last record is cut off or it has too many records\n", path);
+		qr_corpus_close(corpus);
+		return -1;
+	}
+
+	if (!index)
+		return 0;
+
+	if (!(file = fopen(index, "wb")))
+	{
+		log_("Error: Could not open corpus index %s\n", index);
+		qr_corpus_close(corpus);
+		return -1;
+	}
+
+	qr_sink_file(&sink, file);
+	qr_corpus_put_index(corpus, &sink);
+	if (qr_sink_flush(&sink) | fclose(file))
+	{
+		log_("Error: Could not write corpus index %s\n", index);
+		qr_corpus_close(corpus);
+		return -1;
+	}
+
+	return 0;
+}
+
+// encodes the delimited records of the input, or the length-prefixed
+// records of the input mapped as a corpus
+int
+qr_driver_run(const qr_driver_options *options, qr_input_options *encode, qr_format format, const qr_raster_options *raster, const qr_output_options *output)
+{
+	qr_batch_reader reader;
+	qr_corpus corpus;
+	FILE *stream;
+	int status;
+
+	if (options->mapped)
+	{
+		if (open_corpus(&corpus, options->input, options->index))
+			return -1;
+		status = write_batch(NULL, &corpus, options, encode, format, raster, output);
+		qr_corpus_close(&corpus);
+		return status;
+	}
+
+	if (!(stream = strcmp(options->input, "-") ? fopen(options->input, "rb") : stdin))
+	{
+		log_("Error: Could not open batch input %s\n", options->input);
+		return -1;
+	}
+
+	qr_batch_reader_init(&reader, stream, options->delimiter);
+	status = write_batch(&reader, NULL, options, encode, format, raster, output);
+	qr_batch_reader_free(&reader);
+	if (stream != stdin) fclose(stream);
+
+	return status;
+}
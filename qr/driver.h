@@ -0,0 +1,27 @@
+#ifndef QR_DRIVER_H
+#define QR_DRIVER_H
+
+#include <qr/input.h>
+#include <qr/output.h>
+#include <qr/qr.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct
+{
+	const char *input;
+	int mapped;  // input is a corpus of length-prefixed records
+	int delimiter;
+	const char *index;
+	unsigned threads;
+	int ordered;
+	unsigned shard, shard_count;  // this shard from 1 of shard_count
+	int shard_by_hash;
+	const char *manifest;
+	size_t cache_size;  // bytes of outputs kept for repeated records, 0 for none
+	FILE *out;  // records without an output pattern
+} qr_driver_options;
+
+int qr_driver_run(const qr_driver_options *options, qr_input_options *encode, qr_format format, const qr_raster_options *raster, const qr_output_options *output);
+
+#endif // QR_DRIVER_H
@@ -1,5 +1,7 @@
 #include <assert.h>
+#include <pthread.h>
 #include <qr/ecc.h>
+#include <qr/pool.h>
 #include <qr/types.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -7,29 +9,15 @@
 
 #define GF_SIZE 256
 #define PRIMITIVE 0x11D
+#define MAX_ECC_LENGTH 30
 
 word gf_log[GF_SIZE];
 static word gf_antilog[(GF_SIZE * 2) - 2];
-static int gf_tables_initialized = 0;
+static pthread_once_t gf_tables_once = PTHREAD_ONCE_INIT;
 
-static void
-gf_init_log_antilog(void)
-{
-	if (gf_tables_initialized) return;
-
-	size_t i;
-	word x = 1;
-
-	for (i = 0; i < GF_SIZE - 1; ++i)
-	{
-		gf_antilog[i] = x;
-		gf_antilog[i + (GF_SIZE - 1)] = x;
-		gf_log[x] = i;
-		x = (x << 1) ^ ((x & 0x80) ? PRIMITIVE : 0);
-	}
-
-	gf_tables_initialized = 1;
-}
+// the logarithms of the coefficients of the generator polynomial of every
+// degree, none of them is 0
+static word generator_logs[MAX_ECC_LENGTH + 1][MAX_ECC_LENGTH];
 
 static inline word
 gf_mul(word a, word b)
@@ -66,9 +54,44 @@ generator_polynomial(word *poly, size_t degree)
 }
 
 static void
-ecc_generate(const word *data, size_t data_length, word *ecc, size_t ecc_length, word g[ecc_length])
+gf_build_log_antilog(void)
+{
+	size_t i, degree;
+	word x = 1, poly[MAX_ECC_LENGTH];
+
+	for (i = 0; i < GF_SIZE - 1; ++i)
+	{
+		gf_antilog[i] = x;
+		gf_antilog[i + (GF_SIZE - 1)] = x;
+		gf_log[x] = i;
+		x = (x << 1) ^ ((x & 0x80) ? PRIMITIVE : 0);
+	}
+
+	for (degree = 1; degree <= MAX_ECC_LENGTH; ++degree)
+	{
+		generator_polynomial(poly, degree);
+		for (i = 0; i < degree; ++i)
+		{
+			assert(poly[i] && "Generator polynomial has a zero coefficient");
+			generator_logs[degree][i] = gf_log[poly[i]];
+		}
+	}
+}
+
+static void
+gf_init_log_antilog(void)
+{
+	// symbols may be encoded concurrently
+	pthread_once(&gf_tables_once, gf_build_log_antilog);
+}
+
+// the products with the feedback are looked up from the logarithms of the
+// generator coefficients, only the feedback may be 0
+static void
+ecc_generate(const word *data, size_t data_length, word *ecc, size_t ecc_length, const word g_log[ecc_length])
 {
 	size_t i, j;
+	const word *product;
 	word feedback;
 
 	for (i = 0; i < ecc_length; ++i)
@@ -77,9 +100,18 @@ ecc_generate(const word *data, size_t data_length, word *ecc, size_t ecc_length,
 	for (i = 0; i < data_length; ++i)
 	{
 		feedback = gf_add(data[i], ecc[0]);
+		if (!feedback)
+		{
+			for (j = 0; j < ecc_length - 1; ++j)
+				ecc[j] = ecc[j + 1];
+			ecc[ecc_length - 1] = 0;
+			continue;
+		}
+
+		product = gf_antilog + gf_log[feedback];
 		for (j = 0; j < ecc_length - 1; ++j)
-			ecc[j] = gf_add(ecc[j + 1], gf_mul(feedback, g[j]));
-		ecc[ecc_length - 1] = gf_mul(feedback, g[ecc_length - 1]);
+			ecc[j] = gf_add(ecc[j + 1], product[g_log[j]]);
+		ecc[ecc_length - 1] = product[g_log[ecc_length - 1]];
 	}
 }
 
@@ -196,32 +228,98 @@ static const size_t TOTAL_DATA_CODEWORD_COUNT[QR_EC_LEVEL_COUNT][QR_VERSION_COUN
 	}
 };
 
-void
-qr_ec_encode(qr_code *qr)
+size_t
+qr_data_codeword_count(qr_ec_level level, unsigned version)
 {
-	gf_init_log_antilog();
+	return TOTAL_DATA_CODEWORD_COUNT[level][version];
+}
+
+static void
+block_layout(const qr_code *qr, size_t block, size_t *type, size_t *data_offset, size_t *ecc_offset)
+{
+	const size_t *block_count = BLOCK_COUNT[qr->level][qr->version];
+	const size_t *data_length = DATA_CODEWORD_COUNT[qr->level][qr->version];
+	const size_t *total_length = TOTAL_CODEWORD_COUNT[qr->level][qr->version];
+	size_t index = block;
 
-	size_t i, j, data_length, ecc_length;
-	word *data = qr->codewords;
-	word *ecc = qr->codewords + TOTAL_DATA_CODEWORD_COUNT[qr->level][qr->version];
+	*type = block < block_count[0] ? 0 : 1;
+	if (*type) index -= block_count[0];
+
+	*data_offset = (*type ? block_count[0] * data_length[0] : 0) + (index * data_length[*type]);
+	*ecc_offset = TOTAL_DATA_CODEWORD_COUNT[qr->level][qr->version] +
+		(*type ? block_count[0] * (total_length[0] - data_length[0]) : 0) +
+		(index * (total_length[*type] - data_length[*type]));
+}
+
+static void
+encode_blocks(qr_code *qr, size_t first, size_t last)
+{
+	size_t i, type, data_offset, ecc_offset, data_length[BLOCK_TYPES_PER_VERSION], ecc_length[BLOCK_TYPES_PER_VERSION];
+
+	gf_init_log_antilog();
 
 	for (i = 0; i < BLOCK_TYPES_PER_VERSION; ++i)
 	{
-		data_length = DATA_CODEWORD_COUNT[qr->level][qr->version][i];
-		ecc_length = TOTAL_CODEWORD_COUNT[qr->level][qr->version][i] - data_length;
-		word generator[ecc_length];
-		generator_polynomial(generator, ecc_length);
+		data_length[i] = DATA_CODEWORD_COUNT[qr->level][qr->version][i];
+		ecc_length[i] = TOTAL_CODEWORD_COUNT[qr->level][qr->version][i] - data_length[i];
+		assert(ecc_length[i] <= MAX_ECC_LENGTH && "Block has more ec codewords than supported");
+	}
 
-		for (j = 0; j < BLOCK_COUNT[qr->level][qr->version][i]; ++j)
-		{
-			ecc_generate(data, data_length, ecc, ecc_length, generator);
-			data += data_length;
-			ecc += ecc_length;
-		}
+	// every block reads and writes its own region of the codewords only
+	for (i = first; i < last; ++i)
+	{
+		block_layout(qr, i, &type, &data_offset, &ecc_offset);
+		ecc_generate(qr->codewords + data_offset, data_length[type], qr->codewords + ecc_offset, ecc_length[type], generator_logs[ecc_length[type]]);
+	}
+}
+
+size_t
+qr_ec_block_count(const qr_code *qr)
+{
+	return BLOCK_COUNT[qr->level][qr->version][0] + BLOCK_COUNT[qr->level][qr->version][1];
+}
+
+// blocks are independent, so they may be distributed across any executor
+void
+qr_ec_encode_block(qr_code *qr, size_t block)
+{
+	assert(block < qr_ec_block_count(qr) && "Specified block does not exist");
+	encode_blocks(qr, block, block + 1);
+}
+
+void
+qr_ec_encode(qr_code *qr)
+{
+	size_t count = qr_ec_block_count(qr), type, data_offset, ecc_offset;
+
+	encode_blocks(qr, 0, count);
+
+	block_layout(qr, count - 1, &type, &data_offset, &ecc_offset);
+	assert(data_offset + DATA_CODEWORD_COUNT[qr->level][qr->version][type] == TOTAL_DATA_CODEWORD_COUNT[qr->level][qr->version] && "Sum of data codewords in blocks do not match expected number of data codewords");
+	assert(ecc_offset + TOTAL_CODEWORD_COUNT[qr->level][qr->version][type] - DATA_CODEWORD_COUNT[qr->level][qr->version][type] == qr->codeword_count && "Number of generated ec codewords do not match the expected number of codewords");
+}
+
+static void
+encode_block_job(void *context, unsigned worker, size_t block)
+{
+	(void) worker;
+	encode_blocks(context, block, block + 1);
+}
+
+// the blocks are jobs of the pool, whose workers stay alive between symbols
+void
+qr_ec_encode_parallel(qr_code *qr, qr_pool *pool)
+{
+	size_t count = qr_ec_block_count(qr);
+
+	if (!pool || pool->count <= 1 || count <= 1)
+	{
+		qr_ec_encode(qr);
+		return;
 	}
 
-	assert(data - qr->codewords == (long int) TOTAL_DATA_CODEWORD_COUNT[qr->level][qr->version] && "Sum of data codewords in blocks do not match expected number of data codewords");
-	assert(ecc - qr->codewords == (long int) qr->codeword_count && "Number of generated ec codewords do not match the expected number of codewords");
+	gf_init_log_antilog();
+	qr_pool_run(pool, count, encode_block_job, qr);
 }
 
 static word *
@@ -1,9 +1,15 @@
 #ifndef QR_ECC_H
 #define QR_ECC_H
 
+#include <qr/pool.h>
 #include <qr/types.h>
+#include <stddef.h>
 
+size_t qr_data_codeword_count(qr_ec_level level, unsigned version);
+size_t qr_ec_block_count(const qr_code *qr);
+void qr_ec_encode_block(qr_code *qr, size_t block);
 void qr_ec_encode(qr_code *qr);
+void qr_ec_encode_parallel(qr_code *qr, qr_pool *pool);
 void qr_interleave_codewords(qr_code *qr);
 
 #endif // QR_ECC_H
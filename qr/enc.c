@@ -1,43 +1,166 @@
 #include <assert.h>
+#include <qr/ecc.h>
 #include <qr/enc.h>
 #include <qr/types.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
-static const size_t CAPACITY_BYTES[QR_EC_LEVEL_COUNT][QR_VERSION_COUNT] =
-{
-	{ // L
-		  17,   32,   53,   78,  106,  134,  154,  192,  230,  271,
-		 321,  367,  425,  458,  520,  586,  644,  718,  792,  858,
-		 929, 1003, 1091, 1171, 1273, 1367, 1465, 1528, 1628, 1732,
-		1840, 1952, 2068, 2188, 2303, 2431, 2563, 2699, 2809, 2953,
-	},
-	{ // M
-		  14,   26,   42,   62,   84,  106,  122,  152,  180,  213,
-		 251,  287,  331,  362,  412,  450,  504,  560,  624,  666,
-		 711,  779,  857,  911,  997, 1059, 1125, 1190, 1264, 1370,
-		1452, 1538, 1628, 1722, 1809, 1911, 1989, 2099, 2213, 2331,
-	},
-	{ // Q
-		  11,   20,   32,   46,   60,   74,   86,  108,  130,  151,
-		 177,  203,  241,  258,  292,  322,  364,  394,  442,  482,
-		 509,  565,  611,  661,  715,  751,  805,  868,  908,  982,
-		1030, 1112, 1168, 1228, 1283, 1351, 1423, 1499, 1579, 1663,
-	},
-	{ // H
-		   7,   14,   24,   34,   44,   58,   64,   84,   98,  119,
-		 137,  155,  177,  194,  220,  250,  280,  310,  338,  382,
-		 403,  439,  461,  511,  535,  593,  625,  658,  698,  742,
-		 790,  842,  898,  958,  983, 1051, 1093, 1139, 1219, 1273,
-	}
+#define MODE_INDICATOR_BITS 4
+#define KANJI_CHARACTER_BITS 13
+#define STRUCTURED_APPEND_BITS 16
+#define STRUCTURED_APPEND_MAX_SYMBOLS 16
+
+static const unsigned MODE_INDICATOR[QR_MODE_COUNT] =
+{
+	[QR_MODE_NUMERIC]           = 0x1,
+	[QR_MODE_ALPHANUMERIC]      = 0x2,
+	[QR_MODE_BYTE]              = 0x4,
+	[QR_MODE_KANJI]             = 0x8,
+	[QR_MODE_ECI]               = 0x7,
+	[QR_MODE_STRUCTURED_APPEND] = 0x3,
 };
 
+// versions 1-9, 10-26, 27-40
+#define VERSION_CLASS_COUNT 3
+static const unsigned VERSION_CLASS_END[VERSION_CLASS_COUNT] = { 9, 26, 40 };
+static const size_t CHARACTER_COUNT_BITS[QR_MODE_COUNT][VERSION_CLASS_COUNT] =
+{
+	[QR_MODE_NUMERIC]           = { 10, 12, 14 },
+	[QR_MODE_ALPHANUMERIC]      = {  9, 11, 13 },
+	[QR_MODE_BYTE]              = {  8, 16, 16 },
+	[QR_MODE_KANJI]             = {  8, 10, 12 },
+	[QR_MODE_ECI]               = {  0,  0,  0 },
+	[QR_MODE_STRUCTURED_APPEND] = {  0,  0,  0 },
+};
+
+static const char ALPHANUMERIC_CHARSET[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+static size_t
+character_count_bits(qr_encoding_mode mode, unsigned version)
+{
+	return CHARACTER_COUNT_BITS[mode][version + 1 >= 27 ? 2 : version + 1 >= 10 ? 1 : 0];
+}
+
+static size_t
+eci_designator_bits(unsigned eci)
+{
+	return eci < (1 << 7) ? 8 : eci < (1 << 14) ? 16 : 24;
+}
+
+static size_t
+character_count(const qr_segment *segment)
+{
+	return segment->mode == QR_MODE_KANJI ? segment->length / 2 : segment->length;
+}
+
+static size_t
+data_bits(qr_encoding_mode mode, size_t characters)
+{
+	switch (mode)
+	{
+	case QR_MODE_NUMERIC:      return ((characters / 3) * 10) + (size_t []) { 0, 4, 7 }[characters % 3];
+	case QR_MODE_ALPHANUMERIC: return ((characters / 2) * 11) + ((characters % 2) * 6);
+	case QR_MODE_BYTE:         return characters * 8;
+	case QR_MODE_KANJI:        return characters * KANJI_CHARACTER_BITS;
+	default:                   break;
+	}
+
+	assert(0 && "Specified encoding mode is not implemented");
+	return 0;
+}
+
+static int
+alphanumeric_value(char c)
+{
+	const char *position = c ? strchr(ALPHANUMERIC_CHARSET, c) : NULL;
+	return position ? position - ALPHANUMERIC_CHARSET : -1;
+}
+
+static int
+is_numeric(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// the trail byte is checked on its own, a pair such as 0x82 0x00 lies in
+// the range but would be encoded as another character
+static int
+is_kanji(const char *character)
+{
+	unsigned char trail = character[1];
+	unsigned code = ((unsigned char) character[0] << 8) | trail;
+
+	if (trail < 0x40 || trail > 0xFC || trail == 0x7F) return 0;
+	return (code >= 0x8140 && code <= 0x9FFC) || (code >= 0xE040 && code <= 0xEBBF);
+}
+
+static int
+character_allows(const char *data, size_t character_length, qr_encoding_mode mode)
+{
+	switch (mode)
+	{
+	case QR_MODE_NUMERIC:      return character_length == 1 && is_numeric(*data);
+	case QR_MODE_ALPHANUMERIC: return character_length == 1 && alphanumeric_value(*data) >= 0;
+	case QR_MODE_BYTE:         return 1;
+	case QR_MODE_KANJI:        return character_length == 2 && is_kanji(data);
+	default:                   return 0;
+	}
+}
+
+int
+qr_segment_is_valid(const qr_segment *segment)
+{
+	size_t i, step = segment->mode == QR_MODE_KANJI ? 2 : 1;
+
+	if (segment->mode == QR_MODE_ECI) return segment->length == 0 && segment->eci <= QR_ECI_MAX;
+	if (segment->mode == QR_MODE_STRUCTURED_APPEND)
+		return segment->length == 0 && segment->append.index < segment->append.total && segment->append.total <= STRUCTURED_APPEND_MAX_SYMBOLS;
+	if (segment->length % step) return 0;
+
+	for (i = 0; i < segment->length; i += step)
+		if (!character_allows(segment->data + i, step, segment->mode))
+			return 0;
+
+	return 1;
+}
+
+// Shift-JIS double-byte characters are only recognized with kanji set
+size_t
+qr_character_length(const char *data, size_t length, int kanji)
+{
+	unsigned char lead = *data;
+	int double_byte = (lead >= 0x81 && lead <= 0x9F) || (lead >= 0xE0 && lead <= 0xFC);
+	return kanji && double_byte && length >= 2 ? 2 : 1;
+}
+
+size_t
+qr_segment_bits(const qr_segment *segment, unsigned version)
+{
+	if (segment->mode == QR_MODE_ECI)
+		return MODE_INDICATOR_BITS + eci_designator_bits(segment->eci);
+	if (segment->mode == QR_MODE_STRUCTURED_APPEND)
+		return MODE_INDICATOR_BITS + STRUCTURED_APPEND_BITS;
+
+	return MODE_INDICATOR_BITS + character_count_bits(segment->mode, version) + data_bits(segment->mode, character_count(segment));
+}
+
 unsigned
-qr_min_version(size_t bytes, qr_ec_level level)
+qr_min_version(const qr_segment *segments, size_t count, qr_ec_level level)
 {
-	size_t i;
+	size_t i, j, bits;
 
-	for (i = 0; i < QR_VERSION_COUNT && bytes > CAPACITY_BYTES[level][i]; ++i);
+	for (i = 0; i < QR_VERSION_COUNT; ++i)
+	{
+		for (j = 0, bits = 0; j < count; ++j)
+		{
+			if (character_count(&segments[j]) >> character_count_bits(segments[j].mode, i)) break;
+			bits += qr_segment_bits(&segments[j], i);
+		}
+
+		if (j == count && bits <= qr_data_codeword_count(level, i) * 8)
+			break;
+	}
 
 	return (unsigned) i;
 }
@@ -56,53 +179,229 @@ append_bit(word *buffer, size_t *byte, size_t *bit, int value)
 }
 
 static void
-append_byte(word *buffer, size_t *byte, size_t *bit, word value)
+append_bits(word *buffer, size_t *byte, size_t *bit, unsigned value, size_t count)
 {
 	size_t i;
 
-	for (i = 7; i < 8; --i)
+	for (i = count - 1; i < count; --i)
 		append_bit(buffer, byte, bit, (value >> i) & 1);
 }
 
-void
-qr_encode_data(qr_code *qr, const char *message)
+static void
+append_byte(word *buffer, size_t *byte, size_t *bit, word value)
+{
+	append_bits(buffer, byte, bit, value, 8);
+}
+
+static unsigned
+kanji_value(const char *character)
+{
+	unsigned code = ((unsigned char) character[0] << 8) | (unsigned char) character[1];
+
+	code -= code >= 0xE040 ? 0xC140 : 0x8140;
+
+	return ((code >> 8) * 0xC0) + (code & 0xFF);
+}
+
+static void
+encode_segment(qr_code *qr, const qr_segment *segment, size_t *byte, size_t *bit)
 {
-	size_t i, length, byte = 0, bit = 0;
+	size_t i, length = character_count(segment);
+	const char *data = segment->data;
 
-	switch (qr->mode)
+	assert(qr_segment_is_valid(segment) && "Segment contains characters not representable in its mode");
+
+	// mode indicator
+	append_bits(qr->codewords, byte, bit, MODE_INDICATOR[segment->mode], MODE_INDICATOR_BITS);
+
+	// ECI designator, 0, 10 or 110 followed by 7, 14 or 21 bits of assignment number
+	if (segment->mode == QR_MODE_ECI)
 	{
-	case QR_MODE_BYTE:
-		length = strlen(message);
-		assert(length <= CAPACITY_BYTES[qr->level][qr->version] && "Message provided is too large");
+		switch (eci_designator_bits(segment->eci))
+		{
+		case 8:  append_bits(qr->codewords, byte, bit, segment->eci, 8); break;
+		case 16: append_bits(qr->codewords, byte, bit, 0x8000 | segment->eci, 16); break;
+		default: append_bits(qr->codewords, byte, bit, 0xC00000 | segment->eci, 24); break;
+		}
+		return;
+	}
 
-		// byte mode indicator
-		append_bit(qr->codewords, &byte, &bit, 0);
-		append_bit(qr->codewords, &byte, &bit, 1);
-		append_bit(qr->codewords, &byte, &bit, 0);
-		append_bit(qr->codewords, &byte, &bit, 0);
+	// symbol sequence indicator (position and total - 1) and parity
+	if (segment->mode == QR_MODE_STRUCTURED_APPEND)
+	{
+		append_bits(qr->codewords, byte, bit, segment->append.index, 4);
+		append_bits(qr->codewords, byte, bit, segment->append.total - 1, 4);
+		append_byte(qr->codewords, byte, bit, segment->append.parity);
+		return;
+	}
 
-		// character count indicator
-		for (i = qr->version + 1 >= 10 ? 15 : 7; i < 16; --i)
-			append_bit(qr->codewords, &byte, &bit, (length >> i) & 1);
+	// character count indicator
+	append_bits(qr->codewords, byte, bit, length, character_count_bits(segment->mode, qr->version));
 
-		// data
-		for (i = 0; i < length; ++i)
-			append_byte(qr->codewords, &byte, &bit, message[i]);
+	// data
+	switch (segment->mode)
+	{
+	case QR_MODE_NUMERIC:
+		for (i = 0; i + 3 <= length; i += 3)
+			append_bits(qr->codewords, byte, bit, ((data[i] - '0') * 100) + ((data[i + 1] - '0') * 10) + (data[i + 2] - '0'), 10);
+		if (length - i == 2)
+			append_bits(qr->codewords, byte, bit, ((data[i] - '0') * 10) + (data[i + 1] - '0'), 7);
+		else if (length - i == 1)
+			append_bits(qr->codewords, byte, bit, data[i] - '0', 4);
+		break;
 
-		// terminator
-		append_bit(qr->codewords, &byte, &bit, 0);
-		append_bit(qr->codewords, &byte, &bit, 0);
-		append_bit(qr->codewords, &byte, &bit, 0);
-		append_bit(qr->codewords, &byte, &bit, 0);
+	case QR_MODE_ALPHANUMERIC:
+		for (i = 0; i + 2 <= length; i += 2)
+			append_bits(qr->codewords, byte, bit, (alphanumeric_value(data[i]) * 45) + alphanumeric_value(data[i + 1]), 11);
+		if (length - i == 1)
+			append_bits(qr->codewords, byte, bit, alphanumeric_value(data[i]), 6);
+		break;
 
-		// padding
-		while (bit % 8)
-			append_bit(qr->codewords, &byte, &bit, 0);
-		for (i = 0; i < CAPACITY_BYTES[qr->level][qr->version] - length; ++i)
-			append_byte(qr->codewords, &byte, &bit, i % 2 == 0 ? 0xEC : 0x11);
+	case QR_MODE_BYTE:
+		for (i = 0; i < length; ++i)
+			append_byte(qr->codewords, byte, bit, data[i]);
+		break;
+
+	case QR_MODE_KANJI:
+		for (i = 0; i < length; ++i)
+			append_bits(qr->codewords, byte, bit, kanji_value(data + (2 * i)), KANJI_CHARACTER_BITS);
 		break;
 
 	default:
 		assert(0 && "Specified encoding mode is not implemented");
 	}
 }
+
+void
+qr_encode_data(qr_code *qr, const qr_segment *segments, size_t count)
+{
+	size_t i, byte = 0, bit = 0;
+	size_t capacity = qr_data_codeword_count(qr->level, qr->version);
+
+	assert(qr_min_version(segments, count, qr->level) <= qr->version && "Message provided is too large");
+
+	for (i = 0; i < count; ++i)
+		encode_segment(qr, &segments[i], &byte, &bit);
+
+	// terminator, shortened if the symbol is full
+	for (i = 0; i < 4 && byte < capacity; ++i)
+		append_bit(qr->codewords, &byte, &bit, 0);
+
+	// padding
+	while (bit % 8)
+		append_bit(qr->codewords, &byte, &bit, 0);
+	for (i = 0; byte < capacity; ++i)
+		append_byte(qr->codewords, &byte, &bit, i % 2 == 0 ? 0xEC : 0x11);
+}
+
+// costs are tracked in sixths of a bit, so numeric (10 bits per 3 characters)
+// and alphanumeric (11 bits per 2 characters) runs need no rounding until the
+// segment ends
+#define COST_SCALE 6
+#define COST_INFINITE ((size_t) -1)
+
+static const size_t CHARACTER_COST[QR_MODE_COUNT] =
+{
+	[QR_MODE_NUMERIC]           = 20,
+	[QR_MODE_ALPHANUMERIC]      = 33,
+	[QR_MODE_BYTE]              = 48,
+	[QR_MODE_KANJI]             = 78,
+};
+
+
+static size_t
+optimize_for_version(const char *data, size_t length, int kanji, unsigned version, qr_segment *segments, size_t (*cost)[QR_MODE_COUNT], unsigned char (*previous)[QR_MODE_COUNT], size_t *start)
+{
+	size_t i, next, step, candidate, count = 0;
+	unsigned mode, from, best_mode = QR_MODE_BYTE;
+
+	for (i = 0; i <= length; ++i)
+		for (mode = 0; mode < QR_MODE_COUNT; ++mode)
+			cost[i][mode] = COST_INFINITE;
+	for (mode = 0; mode < QR_MODE_ECI; ++mode)
+		cost[0][mode] = (MODE_INDICATOR_BITS + character_count_bits(mode, version)) * COST_SCALE;
+
+	for (i = 0; i < length; i = next)
+	{
+		step = qr_character_length(data + i, length - i, kanji);
+		next = i + step;
+		start[next] = i;
+
+		for (mode = 0; mode < QR_MODE_COUNT; ++mode)
+		{
+			if (!character_allows(data + i, step, mode)) continue;
+
+			for (from = 0; from < QR_MODE_COUNT; ++from)
+			{
+				if (cost[i][from] == COST_INFINITE) continue;
+
+				// switching modes rounds up the finished segment and pays for a new header
+				candidate = from == mode ? cost[i][from] :
+					(((cost[i][from] + COST_SCALE - 1) / COST_SCALE) * COST_SCALE) +
+					((MODE_INDICATOR_BITS + character_count_bits(mode, version)) * COST_SCALE);
+				candidate += CHARACTER_COST[mode] * (mode == QR_MODE_BYTE ? step : 1);
+
+				if (candidate < cost[next][mode])
+				{
+					cost[next][mode] = candidate;
+					previous[next][mode] = from;
+				}
+			}
+		}
+	}
+
+	for (mode = 0; mode < QR_MODE_COUNT; ++mode)
+		if (cost[length][mode] < cost[length][best_mode])
+			best_mode = mode;
+
+	// walk back from the end, emitting segments in reverse order
+	for (i = length, mode = best_mode; i > 0; i = start[i])
+	{
+		if (!count || segments[count - 1].mode != mode)
+			segments[count++] = (qr_segment) { .mode = mode, .data = data + i, .length = 0 };
+
+		segments[count - 1].data = data + start[i];
+		segments[count - 1].length += i - start[i];
+		mode = previous[i][mode];
+	}
+
+	if (!count)
+		segments[count++] = (qr_segment) { .mode = QR_MODE_BYTE, .data = data, .length = 0 };
+
+	for (i = 0; i < count / 2; ++i)
+	{
+		qr_segment swap = segments[i];
+		segments[i] = segments[count - 1 - i];
+		segments[count - 1 - i] = swap;
+	}
+
+	return count;
+}
+
+// splits data into the segments of minimal total bit length; with kanji set,
+// data is Shift-JIS and double-byte characters may also use kanji mode.
+// the first prefix segments (e.g. ECI) are kept and count towards the
+// version, segments must hold prefix + length + 1 entries; returns the total
+// number of segments and stores the smallest fitting version
+// (QR_VERSION_COUNT if none fits)
+size_t
+qr_segments_optimize(const char *data, size_t length, int kanji, qr_ec_level level, qr_segment *segments, size_t prefix, unsigned *version)
+{
+	size_t count = 0, class;
+	size_t (*cost)[QR_MODE_COUNT] = malloc((length + 1) * sizeof(*cost));
+	unsigned char (*previous)[QR_MODE_COUNT] = malloc((length + 1) * sizeof(*previous));
+	size_t *start = malloc((length + 1) * sizeof(*start));
+
+	for (class = 0; class < VERSION_CLASS_COUNT; ++class)
+	{
+		count = prefix + optimize_for_version(data, length, kanji, VERSION_CLASS_END[class] - 1, segments + prefix, cost, previous, start);
+		*version = qr_min_version(segments, count, level);
+		if (*version < VERSION_CLASS_END[class]) break;
+	}
+
+	free(start);
+	free(previous);
+	free(cost);
+
+	return count;
+}
@@ -4,7 +4,11 @@
 #include <qr/types.h>
 #include <stddef.h>
 
-unsigned qr_min_version(size_t bytes, qr_ec_level level);
-void qr_encode_data(qr_code *qr, const char *message);
+int qr_segment_is_valid(const qr_segment *segment);
+size_t qr_character_length(const char *data, size_t length, int kanji);
+size_t qr_segment_bits(const qr_segment *segment, unsigned version);
+unsigned qr_min_version(const qr_segment *segments, size_t count, qr_ec_level level);
+size_t qr_segments_optimize(const char *data, size_t length, int kanji, qr_ec_level level, qr_segment *segments, size_t prefix, unsigned *version);
+void qr_encode_data(qr_code *qr, const qr_segment *segments, size_t count);
 
 #endif // QR_ENC_H
@@ -0,0 +1,197 @@
+#include <qr/append.h>
+#include <qr/enc.h>
+#include <qr/input.h>
+#include <qr/matrix.h>
+#include <qr/qr.h>
+#include <qr/sink.h>
+#include <qr/sjis.h>
+#include <qr/store.h>
+#include <qr/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern void log_(const char *fmt, ...);
+
+_Thread_local int qr_log_muted;
+
+static const char *MODE_NAMES[QR_MODE_COUNT] =
+{
+	[QR_MODE_NUMERIC]           = "numeric",
+	[QR_MODE_ALPHANUMERIC]      = "alphanumeric",
+	[QR_MODE_BYTE]              = "byte",
+	[QR_MODE_KANJI]             = "kanji",
+	[QR_MODE_ECI]               = "eci",
+	[QR_MODE_STRUCTURED_APPEND] = "append",
+};
+
+const char *
+qr_input_mode_name(qr_encoding_mode mode)
+{
+	return MODE_NAMES[mode];
+}
+
+// the options that change the symbol, the start of the keys of the symbol
+// store and the output cache
+void
+qr_input_put_settings(qr_sink *sink, const qr_input_options *options)
+{
+	const long settings[] = { options->mode, options->optimize, options->eci, options->level, options->min_version, options->max_version };
+
+	qr_sink_put(sink, settings, sizeof(settings));
+}
+
+// unpacks the stored symbol of input into reuse or a new symbol and returns
+// 1, the key is kept to store the symbol once it is encoded otherwise
+static int
+get_stored(const char *input, size_t length, const qr_input_options *options, qr_code *reuse, qr_code **symbol, qr_buffer *key)
+{
+	qr_sink sink;
+
+	qr_sink_memory(&sink, key);
+	qr_input_put_settings(&sink, options);
+	qr_sink_put(&sink, input, length);
+	qr_sink_flush(&sink);
+
+	*symbol = reuse ? reuse : qr_create(options->level, options->mode, 0);
+	if (qr_store_get(options->store, key->data, key->length, *symbol))
+		return 1;
+
+	if (!reuse) qr_destroy(*symbol);
+	return 0;
+}
+
+// encodes one input into one symbol, or several with structured append,
+// and returns the number of symbols, 0 on error. a single symbol is encoded
+// into reuse instead of a new one if it is given. the input needs no NUL
+// terminator and may contain NUL bytes. with a store a single symbol is
+// unpacked if it was encoded before, and stored once it is encoded
+size_t
+qr_input_encode(const char *input, size_t length, const qr_input_options *options, qr_code *reuse, qr_code *symbols[QR_APPEND_MAX_SYMBOLS])
+{
+	qr_segment *segments;
+	size_t i, count, prefix, converted_length, message_length, symbol_count = 0;
+	qr_buffer key = { 0 };
+	unsigned version;
+	char *converted;
+	int kanji;
+
+	if (options->store && get_stored(input, length, options, reuse, &symbols[0], &key))
+	{
+		if (!options->quiet)
+			log_("QR Code Generation:\n  Input: %.*s\n  Stored symbol, version %u\n\n", (int) length, input, symbols[0]->version + 1);
+		qr_buffer_free(&key);
+		return 1;
+	}
+
+	// Shift-JIS is only used if it lets characters outside of ASCII use kanji
+	// mode, a declared character set is passed through unchanged
+	converted = malloc(length + 1);
+	converted_length = options->eci < 0 ? qr_utf8_to_sjis(input, length, converted) : QR_SJIS_INVALID;
+	kanji = converted_length != QR_SJIS_INVALID && (converted_length != length || memcmp(converted, input, length));
+	if (!options->optimize && options->mode == QR_MODE_KANJI && !kanji)
+	{
+		log_("Error: Input is not representable in kanji mode\n");
+		qr_buffer_free(&key);
+		free(converted);
+		return 0;
+	}
+
+	const char *message = input;
+	message_length = length;
+	if (kanji && (options->optimize || options->mode == QR_MODE_KANJI))
+	{
+		message = converted;
+		message_length = converted_length;
+	}
+	segments = malloc((message_length + 2) * sizeof(*segments));
+
+	prefix = 0;
+	if (options->eci >= 0)
+		segments[prefix++] = (qr_segment) { .mode = QR_MODE_ECI, .eci = options->eci };
+
+	if (options->optimize)
+	{
+		count = qr_segments_optimize(message, message_length, kanji, options->level, segments, prefix, &version);
+	}
+	else
+	{
+		count = prefix + 1;
+		segments[prefix] = (qr_segment) { .mode = options->mode, .data = message, .length = message_length };
+		if (!qr_segment_is_valid(&segments[prefix]))
+		{
+			log_("Error: Input is not representable in %s mode\n", MODE_NAMES[options->mode]);
+			qr_buffer_free(&key);
+			free(segments);
+			free(converted);
+			return 0;
+		}
+		version = qr_min_version(segments, count, options->level);
+	}
+
+	if (!options->quiet)
+	{
+		log_("QR Code Generation:\n");
+		log_("  Input: %.*s\n", (int) length, input);
+		log_("  Error Correction: %s\n", (const char *[]) { "L (7%)", "M (15%)", "Q (25%)", "H (30%)" }[options->level]);
+	}
+
+	if (version < options->min_version)
+		version = options->min_version;
+
+	if (version <= options->max_version)
+	{
+		if (!options->quiet)
+		{
+			log_("  Segments:");
+			for (i = 0; i < count; ++i)
+				log_(" %s(%zu)", MODE_NAMES[segments[i].mode], segments[i].mode == QR_MODE_ECI ? segments[i].eci : segments[i].length);
+			log_("\n");
+			log_("  Version: %u\n", version + 1);
+			log_("\n");
+		}
+
+		if (reuse)
+			qr_reset(symbols[0] = reuse, options->level, options->mode, version);
+		else
+			symbols[0] = qr_create(options->level, options->mode, version);
+		symbols[0]->ec_pool = options->ec_pool;
+		qr_log_muted = options->quiet;
+		qr_encode_segments(symbols[0], segments, count);
+		qr_log_muted = 0;
+		symbol_count = 1;
+
+		if (options->store && qr_store_put(options->store, key.data, key.length, symbols[0]))
+			log_("Warn: Could not write to the symbol store\n");
+	}
+	else if (options->split)
+	{
+		// structured append always uses mixed-mode segmentation
+		log_("  Structured append: up to version %u per symbol\n", options->max_version + 1);
+		log_("\n");
+
+		symbol_count = qr_append_encode(message, message_length, kanji, options->level, options->max_version, segments, prefix, symbols);
+		if (!symbol_count)
+			log_("Error: Input too large for %d QR codes\n", QR_APPEND_MAX_SYMBOLS);
+	}
+	else
+	{
+		log_("Error: Input too large for version %u\n", options->max_version + 1);
+	}
+
+	if (!options->quiet)
+		log_("\n");
+
+	#ifndef NDEBUG
+	for (i = 0; i < symbol_count && !options->quiet; ++i)
+	{
+		log_("Symbol %zu of %zu, version %u:\n", i + 1, symbol_count, symbols[i]->version + 1);
+		qr_matrix_print(symbols[i], stderr);
+	}
+	#endif
+
+	qr_buffer_free(&key);
+	free(segments);
+	free(converted);
+	return symbol_count;
+}
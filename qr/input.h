@@ -0,0 +1,32 @@
+#ifndef QR_INPUT_H
+#define QR_INPUT_H
+
+#include <qr/append.h>
+#include <qr/pool.h>
+#include <qr/sink.h>
+#include <qr/store.h>
+#include <qr/types.h>
+#include <stddef.h>
+
+// set while the library reports the progress of a quiet encoding
+extern _Thread_local int qr_log_muted;
+
+typedef struct
+{
+	qr_encoding_mode mode;
+	int optimize;
+	long eci;
+	qr_ec_level level;
+	unsigned min_version;  // larger symbols than needed, to compare them
+	unsigned max_version;
+	qr_pool *ec_pool;  // error correction of single symbols, NULL for none
+	int split;  // structured append for input exceeding max_version
+	int quiet;  // only errors are logged
+	qr_store *store;  // symbols of earlier runs, NULL for none
+} qr_input_options;
+
+const char *qr_input_mode_name(qr_encoding_mode mode);
+void qr_input_put_settings(qr_sink *sink, const qr_input_options *options);
+size_t qr_input_encode(const char *input, size_t length, const qr_input_options *options, qr_code *reuse, qr_code *symbols[QR_APPEND_MAX_SYMBOLS]);
+
+#endif // QR_INPUT_H
@@ -1,18 +1,30 @@
-#include <qr/enc.h>
-#include <qr/matrix.h>
+#include <qr/append.h>
+#include <qr/batch.h>
+#include <qr/deflate.h>
+#include <qr/diff.h>
+#include <qr/driver.h>
+#include <qr/input.h>
+#include <qr/output.h>
+#include <qr/pool.h>
 #include <qr/qr.h>
+#include <qr/raster.h>
+#include <qr/sheet.h>
+#include <qr/store.h>
 #include <qr/types.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 void
 log_(const char *fmt, ...)
 #ifdef NDEBUG
-{ (void) fmt; }
+{ (void) fmt; (void) qr_log_muted; }
 #else
 {
 	va_list args;
+	if (qr_log_muted) return;
 	va_start(args, fmt);
 	vfprintf(stderr, fmt, args);
 	va_end(args);
@@ -23,8 +35,45 @@ log_(const char *fmt, ...)
 static void
 print_usage(const char *program_name)
 {
-	log_("Usage: %s <string> [error_correction]\n", program_name);
+	log_("Usage: %s [-m mode] [-e eci] [-l level] [-s max_version] [-j threads] [-f format] [-x scale] [-q quiet_zone] [-z compression] [-D directory] [-o output] <string> [error_correction]\n", program_name);
+	log_("       %s -B input [-0] [-T threads] [-U] [-N shard] [-W manifest] [-C cache_size] [-o pattern] [options]\n", program_name);
+	log_("       %s -R corpus [-I index] [-T threads] [-U] [-N shard] [-W manifest] [-C cache_size] [-o pattern] [options]\n", program_name);
+	log_("       %s -d previous [-b] [options] <string>\n", program_name);
+	log_("       %s -S [-P page] [-M margin] [-c caption_size] [options] <string>...\n", program_name);
 	log_("  error_correction: L (7%%), M (15%%), Q (25%%), H (30%%). Default: M\n");
+	log_("  -m mode: auto, numeric, alphanumeric, byte, kanji. Default: auto\n");
+	log_("    auto mixes modes to minimize the symbol size, kanji converts UTF-8 input to Shift-JIS\n");
+	log_("  -e eci: declare the character set of the input, e.g. 26 for UTF-8\n");
+	log_("  -l level: error correction level, same as the error_correction argument\n");
+	log_("  -s max_version: split input exceeding this version into up to 16 symbols. Default: 40\n");
+	log_("  -j threads: compute error correction blocks of a symbol in parallel, not in batches. Default: 1\n");
+	log_("  -f format: svg (one rect per module), svg-path (one path of dark runs),\n");
+	log_("    svg-defs (patterns reused from definitions), png, pbm, pgm, utf8, ansi, pdf, eps. Default: svg\n");
+	log_("  -x scale: pixels per module of raster formats, points per module of pdf and eps. Default: 4\n");
+	log_("    a list such as 1,4,12 renders every scale in one pass to output-1x, output-4x, ...\n");
+	log_("  -q quiet_zone: light modules around raster, text, pdf and eps formats. Default: 4\n");
+	log_("  -z compression: gzip the output, e.g. svg as svgz, fast (fixed codes) or best (dynamic codes)\n");
+	log_("  -D directory: keep every symbol in a store in directory and reuse it in later runs\n");
+	log_("  -o output: write to a file instead of stdout, a split input is written to output-1, output-2, ...\n");
+	log_("    without -o split symbols are placed next to each other in one document\n");
+	log_("  -B input: encode every line of a file, - for stdin, to files named by -o with %%n replaced\n");
+	log_("    by the line number, or to stdout as records of a 32-bit big endian length and the output\n");
+	log_("  -0: input records end with a NUL byte instead of a newline or CRLF\n");
+	log_("  -R corpus: like -B for a mapped file of records of a 32-bit big endian length and the payload\n");
+	log_("  -I index: 64-bit big endian offsets of the corpus records, written first if it does not exist\n");
+	log_("  -T threads: encode batch records in parallel. Default: number of cores\n");
+	log_("  -U: write batch records to stdout as they complete, each after its 32-bit record number\n");
+	log_("  -N shard: i/n encodes every n-th record starting at record i, i/n:hash the i-th of n shares\n");
+	log_("    chosen by a hash of the payload, stdout records then carry their record number\n");
+	log_("  -W manifest: write one line of record number, size and output file or stdout offset per record\n");
+	log_("  -C cache_size: keep the outputs of up to this many bytes, e.g. 64M, for repeated batch payloads\n");
+	log_("  -d previous: write the modules that changed from the symbol of previous, one line of\n");
+	log_("    column row width height state per rectangle, both symbols at the larger version\n");
+	log_("  -b: write the changes as binary records of five bytes after a 32-bit count\n");
+	log_("  -S: lay out one symbol per argument on a grid of pages in one svg or pdf document\n");
+	log_("  -P page: a4, letter or WIDTHxHEIGHT in points. Default: a4\n");
+	log_("  -M margin: page margin in points. Default: 36\n");
+	log_("  -c caption_size: font size of the input printed below each symbol, 0 for none. Default: 0\n");
 }
 
 static qr_ec_level
@@ -44,39 +93,666 @@ parse_ec_level(const char *level_str)
 	}
 }
 
+static int
+parse_mode(const char *mode_str, qr_encoding_mode *mode, int *optimize)
+{
+	*optimize = !strcmp(mode_str, "auto");
+	if (*optimize) return 0;
+
+	for (*mode = 0; *mode < QR_MODE_ECI; ++*mode)
+		if (!strcmp(mode_str, qr_input_mode_name(*mode)))
+			return 0;
+
+	return -1;
+}
+
+static int
+parse_compression(const char *compression_str, qr_deflate_level *level)
+{
+	if (!strcmp(compression_str, "fast")) *level = QR_DEFLATE_FAST;
+	else if (!strcmp(compression_str, "best")) *level = QR_DEFLATE_BEST;
+	else return -1;
+
+	return 0;
+}
+
+static int
+parse_format(const char *format_str, qr_format *format)
+{
+	if (!strcmp(format_str, "svg")) *format = QR_FORMAT_SVG;
+	else if (!strcmp(format_str, "svg-path")) *format = QR_FORMAT_SVG_PATH;
+	else if (!strcmp(format_str, "svg-defs")) *format = QR_FORMAT_SVG_DEFS;
+	else if (!strcmp(format_str, "png")) *format = QR_FORMAT_PNG;
+	else if (!strcmp(format_str, "pbm")) *format = QR_FORMAT_PBM;
+	else if (!strcmp(format_str, "pgm")) *format = QR_FORMAT_PGM;
+	else if (!strcmp(format_str, "utf8")) *format = QR_FORMAT_UTF8;
+	else if (!strcmp(format_str, "ansi")) *format = QR_FORMAT_ANSI;
+	else if (!strcmp(format_str, "pdf")) *format = QR_FORMAT_PDF;
+	else if (!strcmp(format_str, "eps")) *format = QR_FORMAT_EPS;
+	else return -1;
+
+	return 0;
+}
+
+#define MAX_SCALES 8
+
+// a comma separated list of scales, several render from one pass
+static int
+parse_scales(const char *scales_str, size_t scales[MAX_SCALES], size_t *count)
+{
+	const char *p = scales_str;
+	char *end;
+	long value;
+
+	for (*count = 0; *count < MAX_SCALES; ++*count)
+	{
+		value = strtol(p, &end, 10);
+		if (end == p || value < 1 || value > 1000) return -1;
+		scales[*count] = value;
+
+		if (!*end)
+		{
+			++*count;
+			return 0;
+		}
+		if (*end != ',') return -1;
+		p = end + 1;
+	}
+
+	return -1;
+}
+
+static int
+write_symbols(qr_code **symbols, size_t count, qr_format format, const qr_raster_options *options, const qr_output_options *output)
+{
+	char suffix[24];
+	size_t i;
+	FILE *stream;
+	qr_output_sink out;
+	qr_sink *sink;
+
+	if (!output->path)
+	{
+		if (count > 1 && format != QR_FORMAT_SVG && format != QR_FORMAT_SVG_PATH && format != QR_FORMAT_SVG_DEFS)
+		{
+			log_("Error: Split input in a raster format requires -o\n");
+			return -1;
+		}
+
+		sink = qr_output_begin(&out, stdout, output);
+		if (count == 1) qr_render(symbols[0], format, options, sink);
+		else qr_svg_render_set(symbols, count, format == QR_FORMAT_SVG ? QR_SVG_RECT : format == QR_FORMAT_SVG_PATH ? QR_SVG_PATH : QR_SVG_DEFS, sink);
+
+		if (qr_output_end(&out))
+		{
+			log_("Error: Could not write output\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	for (i = 0; i < count; ++i)
+	{
+		snprintf(suffix, sizeof(suffix), "-%zu", i + 1);
+		if (!(stream = qr_output_open(output->path, count > 1 ? suffix : NULL)))
+		{
+			log_("Error: Could not open output file for symbol %zu\n", i + 1);
+			return -1;
+		}
+
+		sink = qr_output_begin(&out, stream, output);
+		qr_render(symbols[i], format, options, sink);
+		if (qr_output_end(&out) | fclose(stream))
+		{
+			log_("Error: Could not write output file for symbol %zu\n", i + 1);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// renders every scale in one pass into output-<scale>x files
+static int
+write_scales(const qr_code *qr, qr_format format, const qr_raster_options *raster, const size_t *scales, size_t count, const qr_output_options *output)
+{
+	qr_render_target targets[MAX_SCALES];
+	qr_output_options options[MAX_SCALES];
+	FILE *streams[MAX_SCALES];
+	qr_output_sink *out = malloc(count * sizeof(*out));
+	char suffix[24];
+	size_t i, opened;
+	int status = 0;
+
+	for (opened = 0; opened < count; ++opened)
+	{
+		snprintf(suffix, sizeof(suffix), "-%zux", scales[opened]);
+		if (!(streams[opened] = qr_output_open(output->path, suffix)))
+		{
+			log_("Error: Could not open output file for scale %zu\n", scales[opened]);
+			status = -1;
+			break;
+		}
+
+		// every file is compressed on its own
+		options[opened] = *output;
+		if (output->gzip) options[opened].gzip = malloc(sizeof(*output->gzip));
+
+		targets[opened].format = format;
+		targets[opened].options = (qr_raster_options) { .scale = scales[opened], .quiet_zone = raster->quiet_zone };
+		targets[opened].sink = qr_output_begin(&out[opened], streams[opened], &options[opened]);
+	}
+
+	if (!status)
+		qr_render_targets(qr, targets, count);
+
+	for (i = 0; i < opened; ++i)
+	{
+		if ((qr_output_end(&out[i]) | fclose(streams[i])) && !status)
+		{
+			log_("Error: Could not write output file for scale %zu\n", scales[i]);
+			status = -1;
+		}
+		free(options[i].gzip);
+	}
+
+	free(out);
+	return status;
+}
+
+// writes the modules that changed from the symbol of previous to the
+// symbol of input, the smaller one is encoded again at the larger version
+static int
+write_diff(const char *previous, const char *input, qr_input_options *encode, int binary, const qr_output_options *output)
+{
+	qr_code *before[QR_APPEND_MAX_SYMBOLS], *after[QR_APPEND_MAX_SYMBOLS], **smaller;
+	const char *again;
+	qr_diff_rect *rects;
+	qr_output_sink out;
+	qr_sink *sink;
+	size_t count;
+	FILE *stream;
+	int status;
+
+	encode->split = 0;
+	if (!qr_input_encode(previous, strlen(previous), encode, NULL, before)) return -1;
+	if (!qr_input_encode(input, strlen(input), encode, NULL, after))
+	{
+		qr_destroy(before[0]);
+		return -1;
+	}
+
+	if (before[0]->version != after[0]->version)
+	{
+		smaller = before[0]->version < after[0]->version ? before : after;
+		again = smaller == before ? previous : input;
+		encode->min_version = before[0]->version < after[0]->version ? after[0]->version : before[0]->version;
+		qr_destroy(smaller[0]);
+		if (!qr_input_encode(again, strlen(again), encode, NULL, smaller))
+		{
+			qr_destroy(smaller == before ? after[0] : before[0]);
+			return -1;
+		}
+	}
+
+	rects = qr_diff(before[0], after[0], &count);
+	qr_destroy(before[0]);
+	qr_destroy(after[0]);
+	if (!rects)
+	{
+		log_("Error: Out of memory\n");
+		return -1;
+	}
+
+	if (!(stream = output->path ? fopen(output->path, "wb") : stdout))
+	{
+		log_("Error: Could not open output file\n");
+		free(rects);
+		return -1;
+	}
+
+	sink = qr_output_begin(&out, stream, output);
+	if (binary) qr_diff_render_binary(rects, count, sink);
+	else qr_diff_render_text(rects, count, sink);
+
+	status = qr_output_end(&out) | (output->path ? fclose(stream) : 0);
+	if (status)
+		log_("Error: Could not write output\n");
+
+	free(rects);
+	return status ? -1 : 0;
+}
+
+// parses a number of bytes with an optional K, M or G suffix
+static int
+parse_size(const char *size_str, size_t *size)
+{
+	static const char units[] = "KMG";
+	unsigned long long value;
+	const char *unit;
+	unsigned shift = 0;
+	char *end;
+
+	value = strtoull(size_str, &end, 10);
+	if (end == size_str)
+		return -1;
+
+	if (*end && (unit = strchr(units, *end)))
+	{
+		shift = 10 * (unit - units + 1);
+		++end;
+	}
+
+	if (*end || value > (SIZE_MAX >> shift))
+		return -1;
+
+	*size = value << shift;
+	return 0;
+}
+
+// parses i/n or i/n:hash
+static int
+parse_shard(const char *shard_str, qr_driver_options *batch)
+{
+	unsigned long shard, count;
+	char *end;
+
+	shard = strtoul(shard_str, &end, 10);
+	if (end == shard_str || *end != '/')
+		return -1;
+
+	count = strtoul(end + 1, &end, 10);
+	batch->shard_by_hash = !strcmp(end, ":hash");
+	if ((*end && !batch->shard_by_hash) || !shard || shard > count || count > 1000000)
+		return -1;
+
+	batch->shard = shard;
+	batch->shard_count = count;
+	return 0;
+}
+
+static int
+parse_page(const char *page_str, qr_sheet_options *sheet)
+{
+	unsigned long width, height;
+	char *end;
+
+	if (!strcmp(page_str, "a4"))
+	{
+		sheet->page_width = QR_SHEET_PAGE_WIDTH;
+		sheet->page_height = QR_SHEET_PAGE_HEIGHT;
+		return 0;
+	}
+	if (!strcmp(page_str, "letter"))
+	{
+		sheet->page_width = 612;
+		sheet->page_height = 792;
+		return 0;
+	}
+
+	width = strtoul(page_str, &end, 10);
+	if (*end != 'x' || !width) return -1;
+	height = strtoul(end + 1, &end, 10);
+	if (*end || !height) return -1;
+
+	sheet->page_width = width;
+	sheet->page_height = height;
+	return 0;
+}
+
+static int
+write_sheet(qr_code **symbols, const char **captions, size_t count, qr_format format, const qr_sheet_options *sheet, const qr_output_options *output)
+{
+	FILE *stream = output->path ? fopen(output->path, "wb") : stdout;
+	qr_output_sink out;
+	int status;
+
+	if (!stream)
+	{
+		log_("Error: Could not open output file\n");
+		return -1;
+	}
+
+	status = qr_render_sheet(symbols, captions, count, format, sheet, qr_output_begin(&out, stream, output));
+	if (status)
+		log_("Error: Symbols do not fit the page\n");
+
+	if (qr_output_end(&out) && !status)
+	{
+		log_("Error: Could not write output\n");
+		status = -1;
+	}
+	if (output->path && fclose(stream) && !status)
+	{
+		log_("Error: Could not write output file\n");
+		status = -1;
+	}
+
+	return status;
+}
+
 int
 main(int argc, char **argv)
 {
-	if (argc < 2)
+	qr_input_options encode = { .mode = QR_MODE_BYTE, .optimize = 1, .eci = -1, .level = QR_EC_LEVEL_M, .min_version = 0, .max_version = QR_VERSION_COUNT - 1, .ec_pool = NULL, .split = 1, .quiet = 0, .store = NULL };
+	qr_sheet_options sheet = { QR_SHEET_PAGE_WIDTH, QR_SHEET_PAGE_HEIGHT, QR_SHEET_MARGIN, 4, QR_QUIET_ZONE, 0 };
+	qr_code *symbols[QR_APPEND_MAX_SYMBOLS], **sheet_symbols;
+	qr_format format = QR_FORMAT_SVG;
+	qr_raster_options raster = { .scale = 4, .quiet_zone = QR_QUIET_ZONE };
+	qr_output_options output = { .path = NULL, .gzip = NULL, .level = QR_DEFLATE_FAST };
+	size_t i, symbol_count, created, scales[MAX_SCALES], scale_count = 1;
+	long value;
+	char *end;
+	const char *previous = NULL, *store_path = NULL;
+	qr_store store;
+	qr_pool ec_pool;
+	unsigned ec_threads = 1;
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	qr_driver_options batch = { .input = NULL, .delimiter = '\n', .threads = cores > 0 ? cores : 1, .ordered = 1, .shard = 1, .shard_count = 1, .out = stdout };
+	int opt, status, sheet_mode = 0, level_given = 0, compress = 0, binary = 0;
+
+	while ((opt = getopt(argc, argv, "m:e:l:s:j:f:x:q:z:D:o:B:0R:I:T:UN:W:C:d:bSP:M:c:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'm':
+			if (parse_mode(optarg, &encode.mode, &encode.optimize))
+			{
+				log_("Error: Invalid encoding mode %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'e':
+			encode.eci = strtol(optarg, &end, 10);
+			if (*end || encode.eci < 0 || encode.eci > QR_ECI_MAX)
+			{
+				log_("Error: Invalid ECI assignment number %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'l':
+			encode.level = parse_ec_level(optarg);
+			level_given = 1;
+			break;
+
+		case 's':
+			value = strtol(optarg, &end, 10);
+			if (*end || value < 1 || value > QR_VERSION_COUNT)
+			{
+				log_("Error: Invalid version %s\n", optarg);
+				return 1;
+			}
+			encode.max_version = value - 1;
+			break;
+
+		case 'j':
+			value = strtol(optarg, &end, 10);
+			if (*end || value < 1 || value > 256)
+			{
+				log_("Error: Invalid thread count %s\n", optarg);
+				return 1;
+			}
+			ec_threads = value;
+			break;
+
+		case 'f':
+			if (parse_format(optarg, &format))
+			{
+				log_("Error: Invalid output format %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'x':
+			if (parse_scales(optarg, scales, &scale_count))
+			{
+				log_("Error: Invalid scale %s\n", optarg);
+				return 1;
+			}
+			raster.scale = sheet.module = scales[0];
+			break;
+
+		case 'q':
+			value = strtol(optarg, &end, 10);
+			if (*end || value < 0 || value > 1000)
+			{
+				log_("Error: Invalid quiet zone %s\n", optarg);
+				return 1;
+			}
+			raster.quiet_zone = sheet.quiet_zone = value;
+			break;
+
+		case 'z':
+			if (parse_compression(optarg, &output.level))
+			{
+				log_("Error: Invalid compression %s\n", optarg);
+				return 1;
+			}
+			compress = 1;
+			break;
+
+		case 'D':
+			store_path = optarg;
+			break;
+
+		case 'o':
+			output.path = optarg;
+			break;
+
+		case 'B':
+			batch.input = optarg;
+			batch.mapped = 0;
+			break;
+
+		case 'R':
+			batch.input = optarg;
+			batch.mapped = 1;
+			break;
+
+		case 'I':
+			batch.index = optarg;
+			break;
+
+		case '0':
+			batch.delimiter = '\0';
+			break;
+
+		case 'T':
+			value = strtol(optarg, &end, 10);
+			if (*end || value < 1 || value > 1024)
+			{
+				log_("Error: Invalid thread count %s\n", optarg);
+				return 1;
+			}
+			batch.threads = value;
+			break;
+
+		case 'U':
+			batch.ordered = 0;
+			break;
+
+		case 'N':
+			if (parse_shard(optarg, &batch))
+			{
+				log_("Error: Invalid shard %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'W':
+			batch.manifest = optarg;
+			break;
+
+		case 'C':
+			if (parse_size(optarg, &batch.cache_size))
+			{
+				log_("Error: Invalid cache size %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'd':
+			previous = optarg;
+			break;
+
+		case 'b':
+			binary = 1;
+			break;
+
+		case 'S':
+			sheet_mode = 1;
+			break;
+
+		case 'P':
+			if (parse_page(optarg, &sheet))
+			{
+				log_("Error: Invalid page size %s\n", optarg);
+				return 1;
+			}
+			break;
+
+		case 'M':
+			value = strtol(optarg, &end, 10);
+			if (*end || value < 0 || value > 10000)
+			{
+				log_("Error: Invalid margin %s\n", optarg);
+				return 1;
+			}
+			sheet.margin = value;
+			break;
+
+		case 'c':
+			value = strtol(optarg, &end, 10);
+			if (*end || value < 0 || value > 1000)
+			{
+				log_("Error: Invalid caption size %s\n", optarg);
+				return 1;
+			}
+			sheet.caption_size = value;
+			break;
+
+		default:
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind >= argc && !batch.input)
 	{
 		print_usage(argv[0]);
 		return 1;
 	}
 
-	const char *input = argv[1];
-	qr_ec_level ec_level = (argc > 2) ? parse_ec_level(argv[2]) : QR_EC_LEVEL_M;
+	if (batch.input && (sheet_mode || previous || scale_count > 1))
+	{
+		log_("Error: Batches cannot be combined with sheets, changes or several scales\n");
+		return 1;
+	}
 
-	unsigned version = qr_min_version(strlen(input), ec_level);
-	if (version >= QR_VERSION_COUNT)
+	if (batch.input && output.path && !qr_batch_pattern_is_valid(output.path))
 	{
-		log_("Error: Input too large for QR code\n");
+		log_("Error: Output pattern %s needs %%n for the record number\n", output.path);
 		return 1;
 	}
 
-	log_("QR Code Generation:\n");
-	log_("  Input: %s\n", input);
-	log_("  Error Correction: %s\n", (const char *[]) { "L (7%)", "M (15%)", "Q (25%)", "H (30%)" }[ec_level]);
-	log_("  Version: %u\n", version + 1);
-	log_("\n");
+	if (sheet_mode && format != QR_FORMAT_SVG && format != QR_FORMAT_SVG_PATH && format != QR_FORMAT_SVG_DEFS && format != QR_FORMAT_PDF)
+	{
+		log_("Error: Sheets are only available as svg, svg-path, svg-defs or pdf\n");
+		return 1;
+	}
 
-	qr_code *qr = qr_create(ec_level, QR_MODE_BYTE, version);
-	qr_encode_message(qr, input);
-	log_("\n");
-	#ifndef NDEBUG
-	qr_matrix_print(qr, stderr);
-	#endif
-	qr_svg_print(qr, stdout);
-	qr_destroy(qr);
+	if (previous && (sheet_mode || scale_count > 1))
+	{
+		log_("Error: Changes cannot be written for sheets or several scales\n");
+		return 1;
+	}
 
-	return 0;
+	if (scale_count > 1 && (sheet_mode || !output.path))
+	{
+		log_("Error: Several scales require -o and cannot be used for sheets\n");
+		return 1;
+	}
+
+	if (store_path && qr_store_open(encode.store = &store, store_path))
+	{
+		log_("Error: Could not open symbol store %s\n", store_path);
+		return 1;
+	}
+
+	if (compress)
+		output.gzip = malloc(sizeof(*output.gzip));
+
+	// the workers stay alive for every symbol of a sheet or a change
+	if (ec_threads > 1 && !batch.input)
+	{
+		qr_pool_init(&ec_pool, ec_threads);
+		encode.ec_pool = &ec_pool;
+	}
+
+	if (batch.input)
+	{
+		status = qr_driver_run(&batch, &encode, format, &raster, &output);
+		if (encode.store) qr_store_close(&store);
+		if (encode.ec_pool) qr_pool_destroy(&ec_pool);
+		free(output.gzip);
+		return status ? 1 : 0;
+	}
+
+	// every argument is one symbol of the sheet, captioned with its input
+	if (sheet_mode)
+	{
+		encode.split = 0;
+		symbol_count = argc - optind;
+		sheet_symbols = malloc(symbol_count * sizeof(*sheet_symbols));
+
+		for (created = 0; created < symbol_count; ++created)
+			if (!qr_input_encode(argv[optind + created], strlen(argv[optind + created]), &encode, NULL, &sheet_symbols[created]))
+				break;
+
+		status = created < symbol_count ? -1 : write_sheet(sheet_symbols, (const char **) argv + optind, symbol_count, format, &sheet, &output);
+
+		for (i = 0; i < created; ++i)
+			qr_destroy(sheet_symbols[i]);
+		free(sheet_symbols);
+		if (encode.store) qr_store_close(&store);
+		if (encode.ec_pool) qr_pool_destroy(&ec_pool);
+		free(output.gzip);
+
+		return status ? 1 : 0;
+	}
+
+	if (argc > optind + 1 && !level_given)
+		encode.level = parse_ec_level(argv[optind + 1]);
+
+	if (previous)
+	{
+		status = write_diff(previous, argv[optind], &encode, binary, &output);
+		if (encode.store) qr_store_close(&store);
+		if (encode.ec_pool) qr_pool_destroy(&ec_pool);
+		free(output.gzip);
+		return status ? 1 : 0;
+	}
+
+	symbol_count = qr_input_encode(argv[optind], strlen(argv[optind]), &encode, NULL, symbols);
+	if (!symbol_count)
+		status = -1;
+	else if (scale_count > 1 && symbol_count > 1)
+	{
+		log_("Error: Several scales cannot be used for split input\n");
+		status = -1;
+	}
+	else if (scale_count > 1)
+		status = write_scales(symbols[0], format, &raster, scales, scale_count, &output);
+	else
+		status = write_symbols(symbols, symbol_count, format, &raster, &output);
+
+	for (i = 0; i < symbol_count; ++i)
+		qr_destroy(symbols[i]);
+	if (encode.store) qr_store_close(&store);
+	if (encode.ec_pool) qr_pool_destroy(&ec_pool);
+	free(output.gzip);
+
+	return status ? 1 : 0;
 }
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <qr/matrix.h>
 #include <qr/patterns.h>
+#include <qr/sink.h>
 #include <qr/types.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -11,6 +12,27 @@ qr_module_get(const qr_code *qr, size_t i, size_t j)
 	return qr->matrix[i * qr->side_length + j] ? QR_MODULE_DARK : QR_MODULE_LIGHT;
 }
 
+// splits module row i into runs of dark modules, returns their number
+size_t
+qr_module_runs(const qr_code *qr, size_t i, qr_run runs[QR_MAX_RUNS])
+{
+	const int *row = qr->matrix + i * qr->side_length;
+	size_t j = 0, count = 0;
+
+	while (j < qr->side_length)
+	{
+		for (; j < qr->side_length && !row[j]; ++j);
+		if (j == qr->side_length) break;
+
+		runs[count].begin = j;
+		for (; j < qr->side_length && row[j]; ++j);
+		runs[count].length = j - runs[count].begin;
+		++count;
+	}
+
+	return count;
+}
+
 void
 qr_module_set(qr_code *qr, size_t i, size_t j, qr_module_state value)
 {
@@ -18,7 +40,7 @@ qr_module_set(qr_code *qr, size_t i, size_t j, qr_module_state value)
 }
 
 void
-qr_matrix_print(const qr_code *qr, FILE *stream)
+qr_matrix_render(const qr_code *qr, qr_sink *sink)
 {
 	size_t i, j;
 
@@ -26,33 +48,43 @@ qr_matrix_print(const qr_code *qr, FILE *stream)
 	for (i = 0; i < 4; ++i)
 	{
 		for (j = 0; j < qr->side_length + 8; ++j)
-			fprintf(stream, "\x1b[7m  \x1b[27m");
-		fprintf(stream, "\n");
+			qr_sink_puts(sink, "\x1b[7m  \x1b[27m");
+		qr_sink_putc(sink, '\n');
 	}
 
 	for (i = 0; i < qr->side_length; ++i)
 	{
 		// quiet zone
-		fprintf(stream, "\x1b[7m        \x1b[27m");
+		qr_sink_puts(sink, "\x1b[7m        \x1b[27m");
 
 		for (j = 0; j < qr->side_length; ++j)
-			fprintf(stream, "%s", qr_module_get(qr, i, j) ? "  " : "\x1b[7m  \x1b[27m");
+			qr_sink_puts(sink, qr_module_get(qr, i, j) ? "  " : "\x1b[7m  \x1b[27m");
 
 		// quiet zone
-		fprintf(stream, "\x1b[7m        \x1b[27m");
+		qr_sink_puts(sink, "\x1b[7m        \x1b[27m");
 
-		fprintf(stream, "\n");
+		qr_sink_putc(sink, '\n');
 	}
 
 	// quiet zone
 	for (i = 0; i < 4; ++i)
 	{
 		for (j = 0; j < qr->side_length + 8; ++j)
-			fprintf(stream, "\x1b[7m  \x1b[27m");
-		fprintf(stream, "\n");
+			qr_sink_puts(sink, "\x1b[7m  \x1b[27m");
+		qr_sink_putc(sink, '\n');
 	}
 }
 
+void
+qr_matrix_print(const qr_code *qr, FILE *stream)
+{
+	qr_sink sink;
+
+	qr_sink_file(&sink, stream);
+	qr_matrix_render(qr, &sink);
+	qr_sink_flush(&sink);
+}
+
 int
 qr_module_is_reserved(const qr_code *qr, size_t i, size_t j)
 {
@@ -1,20 +1,31 @@
 #ifndef QR_MATRIX_H
 #define QR_MATRIX_H
 
+#include <qr/sink.h>
 #include <qr/types.h>
 #include <stddef.h>
 #include <stdio.h>
 
+#define QR_MAX_RUNS 89  // dark runs in a module row of a version 40 symbol
+
 typedef enum
 {
 	QR_MODULE_LIGHT = 0,
 	QR_MODULE_DARK  = 1,
 } qr_module_state;
 
+typedef struct
+{
+	size_t begin;  // column of the first dark module
+	size_t length;
+} qr_run;
+
 qr_module_state qr_module_get(const qr_code *qr, size_t i, size_t j);
 void qr_module_set(qr_code *qr, size_t i, size_t j, qr_module_state value);
+size_t qr_module_runs(const qr_code *qr, size_t i, qr_run runs[QR_MAX_RUNS]);
 int qr_module_is_reserved(const qr_code *qr, size_t i, size_t j);
 void qr_place_codewords(qr_code *qr);
+void qr_matrix_render(const qr_code *qr, qr_sink *sink);
 void qr_matrix_print(const qr_code *qr, FILE *stream);
 
 #endif // QR_MATRIX_H
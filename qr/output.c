@@ -0,0 +1,59 @@
+#include <qr/deflate.h>
+#include <qr/output.h>
+#include <qr/sink.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// inserts the suffix in front of the extension
+FILE *
+qr_output_open(const char *path, const char *suffix)
+{
+	const char *extension;
+	char *suffixed_path;
+	size_t length;
+	FILE *stream;
+
+	if (!suffix) return fopen(path, "wb");
+
+	extension = strrchr(path, '.');
+	if (!extension || strchr(extension, '/')) extension = path + strlen(path);
+	length = strlen(path) + strlen(suffix) + 1;
+	suffixed_path = malloc(length);
+	snprintf(suffixed_path, length, "%.*s%s%s", (int) (extension - path), path, suffix, extension);
+
+	stream = fopen(suffixed_path, "wb");
+	free(suffixed_path);
+	return stream;
+}
+
+// compresses into the base sink the caller has set up if requested
+qr_sink *
+qr_output_wrap(qr_output_sink *out, const qr_output_options *options)
+{
+	out->gzip = options->gzip;
+	if (!out->gzip) return &out->base;
+
+	qr_deflate_init(out->gzip, QR_DEFLATE_GZIP, options->level, &out->base);
+	qr_deflate_sink(&out->compressed, out->gzip);
+	return &out->compressed;
+}
+
+qr_sink *
+qr_output_begin(qr_output_sink *out, FILE *stream, const qr_output_options *options)
+{
+	qr_sink_file(&out->base, stream);
+	return qr_output_wrap(out, options);
+}
+
+int
+qr_output_end(qr_output_sink *out)
+{
+	if (out->gzip)
+	{
+		qr_sink_flush(&out->compressed);
+		qr_deflate_finish(out->gzip);
+	}
+
+	return qr_sink_flush(&out->base);
+}
@@ -0,0 +1,27 @@
+#ifndef QR_OUTPUT_H
+#define QR_OUTPUT_H
+
+#include <qr/deflate.h>
+#include <qr/sink.h>
+#include <stdio.h>
+
+typedef struct
+{
+	const char *path;  // stdout if NULL
+	qr_deflate *gzip;  // compresses the output if not NULL
+	qr_deflate_level level;
+} qr_output_options;
+
+typedef struct
+{
+	qr_sink base;
+	qr_sink compressed;
+	qr_deflate *gzip;
+} qr_output_sink;
+
+FILE *qr_output_open(const char *path, const char *suffix);
+qr_sink *qr_output_wrap(qr_output_sink *out, const qr_output_options *options);
+qr_sink *qr_output_begin(qr_output_sink *out, FILE *stream, const qr_output_options *options);
+int qr_output_end(qr_output_sink *out);
+
+#endif // QR_OUTPUT_H
@@ -124,11 +124,23 @@ static size_t ALIGNMENT_CENTER_MODULE[QR_VERSION_COUNT][MAX_ALIGNMENT_ENTRIES] =
 	{   6,  30,  58,  86, 114, 142, 170 },
 };
 
-void
-qr_alignment_patterns_apply(qr_code *qr)
+// alignment patterns are placed at every combination of the center modules
+// except those that would overlap the finder patterns, E entries give 0
+static int
+is_alignment_origin(const qr_code *qr, size_t i, size_t j)
+{
+	int in_finder_upper_left = i < 8 && j < 8;
+	int in_finder_upper_right = i < 8 && j >= qr->side_length - 12;
+	int in_finder_lower_left = i >= qr->side_length - 12 && j < 8;
+
+	return i && j && !in_finder_upper_left && !in_finder_upper_right && !in_finder_lower_left;
+}
+
+// collects the top left module of every alignment pattern
+size_t
+qr_alignment_pattern_origins(const qr_code *qr, size_t origins[QR_MAX_ALIGNMENT_PATTERNS][2])
 {
-	size_t entry_a, entry_b, i, j;
-	int in_finder_upper_left, in_finder_upper_right, in_finder_lower_left;
+	size_t entry_a, entry_b, i, j, count = 0;
 
 	for (entry_a = 0; entry_a < MAX_ALIGNMENT_ENTRIES; ++entry_a)
 	{
@@ -136,43 +148,56 @@ qr_alignment_patterns_apply(qr_code *qr)
 		{
 			i = ALIGNMENT_CENTER_MODULE[qr->version][entry_a] - 2;
 			j = ALIGNMENT_CENTER_MODULE[qr->version][entry_b] - 2;
-
-			in_finder_upper_left = i < 8 && j < 8;
-			in_finder_upper_right = i < 8 && j >= qr->side_length - 12;
-			in_finder_lower_left = i >= qr->side_length - 12 && j < 8;
-
-			if (!i || !j || in_finder_upper_left || in_finder_upper_right || in_finder_lower_left)
+			if (!is_alignment_origin(qr, i, j))
 				continue;
 
-			add_alignment_pattern_at(qr, i, j);
+			origins[count][0] = i;
+			origins[count][1] = j;
+			++count;
 		}
 	}
+
+	return count;
 }
 
-int
-qr_is_in_alignment_patterns(const qr_code *qr, size_t i_, size_t j_)
+void
+qr_alignment_patterns_apply(qr_code *qr)
 {
-	size_t entry_a, entry_b, i, j;
-	int in_finder_upper_left, in_finder_upper_right, in_finder_lower_left;
+	size_t origins[QR_MAX_ALIGNMENT_PATTERNS][2], count, k;
 
-	for (entry_a = 0; entry_a < MAX_ALIGNMENT_ENTRIES; ++entry_a)
-	{
-		for (entry_b = 0; entry_b < MAX_ALIGNMENT_ENTRIES; ++entry_b)
-		{
-			i = ALIGNMENT_CENTER_MODULE[qr->version][entry_a] - 2;
-			j = ALIGNMENT_CENTER_MODULE[qr->version][entry_b] - 2;
-
-			in_finder_upper_left = i < 8 && j < 8;
-			in_finder_upper_right = i < 8 && j >= qr->side_length - 12;
-			in_finder_lower_left = i >= qr->side_length - 12 && j < 8;
+	count = qr_alignment_pattern_origins(qr, origins);
+	for (k = 0; k < count; ++k)
+		add_alignment_pattern_at(qr, origins[k][0], origins[k][1]);
+}
 
-			if (!i || !j || in_finder_upper_left || in_finder_upper_right || in_finder_lower_left)
-				continue;
+// finds the origin of the row or column of patterns that covers module k,
+// the centers are more than 5 modules apart so there is at most one
+static int
+find_alignment_origin(const qr_code *qr, size_t k, size_t *origin)
+{
+	size_t entry, center;
 
-			if (i_ >= i && i_ <= i + 4 && j_ >= j && j_ <= j + 4)
-				return 1;
+	for (entry = 0; entry < MAX_ALIGNMENT_ENTRIES; ++entry)
+	{
+		center = ALIGNMENT_CENTER_MODULE[qr->version][entry];
+		if (center == E || center > k + 2)
+			break;
+		if (k <= center + 2)
+		{
+			*origin = center - 2;
+			return 1;
 		}
 	}
 
 	return 0;
 }
+
+// called for every module while placing data and masking, so it looks up
+// the one candidate pattern instead of collecting all of them
+int
+qr_is_in_alignment_patterns(const qr_code *qr, size_t i, size_t j)
+{
+	size_t origin_i, origin_j;
+
+	return find_alignment_origin(qr, i, &origin_i) && find_alignment_origin(qr, j, &origin_j) && is_alignment_origin(qr, origin_i, origin_j);
+}
@@ -4,11 +4,14 @@
 #include <qr/types.h>
 #include <stddef.h>
 
+#define QR_MAX_ALIGNMENT_PATTERNS 46
+
 void qr_finder_patterns_apply(qr_code *qr);
 void qr_separators_apply(qr_code *qr);
 void qr_timing_patterns_apply(qr_code *qr);
 void qr_alignment_patterns_apply(qr_code *qr);
 
+size_t qr_alignment_pattern_origins(const qr_code *qr, size_t origins[QR_MAX_ALIGNMENT_PATTERNS][2]);
 int qr_is_in_alignment_patterns(const qr_code *qr, size_t i, size_t j);
 
 #endif // QR_PATTERNS_H
@@ -0,0 +1,261 @@
+#include <assert.h>
+#include <qr/pdf.h>
+#include <qr/raster.h>
+#include <qr/rects.h>
+#include <qr/sheet.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// PostScript limits arrays to 65535 elements
+#define EPS_RECTS_PER_ARRAY 4096
+
+static void
+put_numbers(qr_sink *sink, const size_t *values, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; ++i)
+	{
+		if (i) qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, values[i]);
+	}
+}
+
+static void
+put_padded(qr_sink *sink, size_t value, size_t digits)
+{
+	char buffer[20];
+	size_t i;
+
+	assert(digits <= sizeof(buffer));
+	for (i = digits; i; value /= 10)
+		buffer[--i] = '0' + value % 10;
+	qr_sink_put(sink, buffer, digits);
+}
+
+// writes x y width height of a rectangle in points, with the origin at the
+// bottom left of the page as both PDF and PostScript expect
+static void
+put_rect(qr_sink *sink, const qr_rect *rect, size_t left, size_t top, size_t module, size_t page_height)
+{
+	size_t values[4] =
+	{
+		left + rect->x * module,
+		page_height - top - (rect->y + rect->height) * module,
+		rect->width * module,
+		rect->height * module,
+	};
+
+	put_numbers(sink, values, 4);
+}
+
+static void
+pdf_begin_object(qr_sink *sink, size_t base, size_t *offsets, size_t object)
+{
+	offsets[object] = sink->written - base;
+	qr_sink_put_uint(sink, object);
+	qr_sink_puts(sink, " 0 obj\n");
+}
+
+static void
+pdf_put_string(qr_sink *sink, const char *text, size_t length)
+{
+	char escaped[4];
+	size_t i;
+
+	qr_sink_putc(sink, '(');
+	for (i = 0; i < length; ++i)
+	{
+		unsigned char c = text[i];
+
+		if (c == '(' || c == ')' || c == '\\')
+		{
+			qr_sink_putc(sink, '\\');
+			qr_sink_putc(sink, c);
+		}
+		else if (c < 0x20 || c >= 0x7F)
+		{
+			escaped[0] = '\\';
+			escaped[1] = '0' + (c >> 6);
+			escaped[2] = '0' + ((c >> 3) & 7);
+			escaped[3] = '0' + (c & 7);
+			qr_sink_put(sink, escaped, 4);
+		}
+		else
+		{
+			qr_sink_putc(sink, c);
+		}
+	}
+	qr_sink_putc(sink, ')');
+}
+
+static void
+pdf_render_page(qr_code **symbols, const char **captions, size_t first, size_t last, const qr_sheet_layout *layout, const qr_sheet_options *options, qr_sink *sink)
+{
+	size_t box[4] = { 0, 0, options->page_width, options->page_height };
+	size_t quiet = options->quiet_zone * options->module, count, i, k, page, x, y, length;
+	qr_rect *rects;
+
+	qr_sink_puts(sink, "1 g ");
+	put_numbers(sink, box, 4);
+	qr_sink_puts(sink, " re f\n0 g\n");
+
+	// one fill for all rectangles of the page
+	for (i = first; i < last; ++i)
+	{
+		qr_sheet_place(layout, options, symbols[i], i, &page, &x, &y);
+		rects = qr_rects_merge(symbols[i], &count);
+		for (k = 0; k < count; ++k)
+		{
+			put_rect(sink, &rects[k], x + quiet, y + quiet, options->module, options->page_height);
+			qr_sink_puts(sink, " re\n");
+		}
+		free(rects);
+	}
+	qr_sink_puts(sink, "f\n");
+
+	for (i = first; i < last && options->caption_size && captions; ++i)
+	{
+		if (!captions[i]) continue;
+
+		qr_sheet_caption(layout, options, i, captions[i], &x, &y, &length);
+		qr_sink_puts(sink, "BT /F1 ");
+		qr_sink_put_uint(sink, options->caption_size);
+		qr_sink_puts(sink, " Tf ");
+		qr_sink_put_uint(sink, x);
+		qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, options->page_height - y);
+		qr_sink_puts(sink, " Td ");
+		pdf_put_string(sink, captions[i], length);
+		qr_sink_puts(sink, " Tj ET\n");
+	}
+}
+
+// objects 1 to 3 are the catalog, the page tree and the caption font,
+// followed by the page, its content stream and the stream length for
+// every page
+int
+qr_pdf_render_sheet(qr_code **symbols, const char **captions, size_t count, const qr_sheet_options *options, qr_sink *sink)
+{
+	size_t box[4] = { 0, 0, options->page_width, options->page_height };
+	size_t base = sink->written, per_page, objects, page, length, xref, i, *offsets;
+	qr_sheet_layout layout;
+
+	if (qr_sheet_layout_compute(symbols, count, options, &layout)) return -1;
+
+	per_page = layout.columns * layout.rows;
+	objects = 4 + 3 * layout.pages;
+	offsets = malloc(objects * sizeof(*offsets));
+
+	// the binary comment marks the file as binary for transfer programs
+	qr_sink_puts(sink, "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+
+	pdf_begin_object(sink, base, offsets, 1);
+	qr_sink_puts(sink, "<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+
+	pdf_begin_object(sink, base, offsets, 2);
+	qr_sink_puts(sink, "<< /Type /Pages /Kids [");
+	for (page = 0; page < layout.pages; ++page)
+	{
+		if (page) qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, 4 + 3 * page);
+		qr_sink_puts(sink, " 0 R");
+	}
+	qr_sink_puts(sink, "] /Count ");
+	qr_sink_put_uint(sink, layout.pages);
+	qr_sink_puts(sink, " >>\nendobj\n");
+
+	pdf_begin_object(sink, base, offsets, 3);
+	qr_sink_puts(sink, "<< /Type /Font /Subtype /Type1 /BaseFont /Courier >>\nendobj\n");
+
+	for (page = 0; page < layout.pages; ++page)
+	{
+		pdf_begin_object(sink, base, offsets, 4 + 3 * page);
+		qr_sink_puts(sink, "<< /Type /Page /Parent 2 0 R /MediaBox [");
+		put_numbers(sink, box, 4);
+		qr_sink_puts(sink, "] /Contents ");
+		qr_sink_put_uint(sink, 5 + 3 * page);
+		qr_sink_puts(sink, " 0 R /Resources << /Font << /F1 3 0 R >> >> >>\nendobj\n");
+
+		// the length is only known once the content is written
+		pdf_begin_object(sink, base, offsets, 5 + 3 * page);
+		qr_sink_puts(sink, "<< /Length ");
+		qr_sink_put_uint(sink, 6 + 3 * page);
+		qr_sink_puts(sink, " 0 R >>\nstream\n");
+		length = sink->written;
+
+		pdf_render_page(symbols, captions, page * per_page, (page + 1) * per_page < count ? (page + 1) * per_page : count, &layout, options, sink);
+
+		length = sink->written - length;
+		qr_sink_puts(sink, "endstream\nendobj\n");
+
+		pdf_begin_object(sink, base, offsets, 6 + 3 * page);
+		qr_sink_put_uint(sink, length);
+		qr_sink_puts(sink, "\nendobj\n");
+	}
+
+	// every cross-reference entry is exactly 20 bytes
+	xref = sink->written - base;
+	qr_sink_puts(sink, "xref\n0 ");
+	qr_sink_put_uint(sink, objects);
+	qr_sink_puts(sink, "\n0000000000 65535 f \n");
+	for (i = 1; i < objects; ++i)
+	{
+		put_padded(sink, offsets[i], 10);
+		qr_sink_puts(sink, " 00000 n \n");
+	}
+
+	qr_sink_puts(sink, "trailer\n<< /Size ");
+	qr_sink_put_uint(sink, objects);
+	qr_sink_puts(sink, " /Root 1 0 R >>\nstartxref\n");
+	qr_sink_put_uint(sink, xref);
+	qr_sink_puts(sink, "\n%%EOF\n");
+
+	free(offsets);
+	return 0;
+}
+
+// a single symbol is a sheet with one page the size of the symbol
+void
+qr_pdf_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink)
+{
+	size_t size = qr_raster_size(qr, options);
+	qr_sheet_options sheet = { size, size, 0, options->scale, options->quiet_zone, 0 };
+	qr_code *symbols[1] = { (qr_code *) qr };
+
+	assert(options->scale > 0);
+	qr_pdf_render_sheet(symbols, NULL, 1, &sheet, sink);
+}
+
+void
+qr_eps_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink)
+{
+	size_t size = qr_raster_size(qr, options), quiet = options->quiet_zone * options->scale, count, i;
+	size_t box[4] = { 0, 0, size, size };
+	qr_rect *rects;
+
+	assert(options->scale > 0);
+
+	qr_sink_puts(sink, "%!PS-Adobe-3.0 EPSF-3.0\n%%BoundingBox: ");
+	put_numbers(sink, box, 4);
+	qr_sink_puts(sink, "\n%%Pages: 0\n%%EndComments\n");
+
+	qr_sink_puts(sink, "1 setgray ");
+	put_numbers(sink, box, 4);
+	qr_sink_puts(sink, " rectfill\n0 setgray\n");
+
+	// rectfill takes any number of rectangles as one array
+	rects = qr_rects_merge(qr, &count);
+	for (i = 0; i < count; ++i)
+	{
+		if (i % EPS_RECTS_PER_ARRAY == 0) qr_sink_puts(sink, "[\n");
+		put_rect(sink, &rects[i], quiet, quiet, options->scale, size);
+		qr_sink_putc(sink, '\n');
+		if (i % EPS_RECTS_PER_ARRAY == EPS_RECTS_PER_ARRAY - 1 || i == count - 1) qr_sink_puts(sink, "] rectfill\n");
+	}
+	free(rects);
+
+	qr_sink_puts(sink, "%%EOF\n");
+}
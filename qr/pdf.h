@@ -0,0 +1,13 @@
+#ifndef QR_PDF_H
+#define QR_PDF_H
+
+#include <qr/raster.h>
+#include <qr/sheet.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+
+void qr_pdf_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink);
+int qr_pdf_render_sheet(qr_code **symbols, const char **captions, size_t count, const qr_sheet_options *options, qr_sink *sink);
+void qr_eps_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink);
+
+#endif // QR_PDF_H
@@ -0,0 +1,122 @@
+#include <assert.h>
+#include <qr/deflate.h>
+#include <qr/matrix.h>
+#include <qr/png.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+static void
+put_uint32_be(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = value >> 24;
+	bytes[1] = value >> 16;
+	bytes[2] = value >> 8;
+	bytes[3] = value;
+}
+
+static void
+write_chunk(qr_sink *sink, const char *type, const void *data, size_t size)
+{
+	uint8_t header[8], crc[4];
+
+	put_uint32_be(header, size);
+	memcpy(header + 4, type, 4);
+	put_uint32_be(crc, qr_crc32(qr_crc32(0, header + 4, 4), data, size));
+
+	qr_sink_put(sink, header, sizeof(header));
+	if (size) qr_sink_put(sink, data, size);
+	qr_sink_put(sink, crc, sizeof(crc));
+}
+
+// every buffer of compressed data leaving the inner sink becomes one chunk
+static size_t
+write_idat(void *context, const void *data, size_t size)
+{
+	qr_sink *sink = context;
+
+	write_chunk(sink, "IDAT", data, size);
+	return sink->error ? 0 : size;
+}
+
+// writes the signature and header, compressed rows follow
+void
+qr_png_begin(qr_png_writer *png, const qr_code *qr, const qr_raster_options *options, qr_sink *sink)
+{
+	size_t size = qr_raster_size(qr, options);
+	uint8_t ihdr[13];
+
+	assert(options->scale > 0);
+
+	png->qr = qr;
+	png->options = *options;
+	png->out = sink;
+	png->row_bytes = qr_raster_row_bytes(qr, options, QR_PIXEL_1BPP);
+
+	// grayscale with a bit depth of 1, no interlacing
+	put_uint32_be(ihdr, size);
+	put_uint32_be(ihdr + 4, size);
+	ihdr[8] = 1;
+	ihdr[9] = 0;
+	ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+	qr_sink_put(sink, SIGNATURE, sizeof(SIGNATURE));
+	write_chunk(sink, "IHDR", ihdr, sizeof(ihdr));
+
+	png->deflate = malloc(sizeof(*png->deflate));
+	png->row = malloc(png->row_bytes + 1);
+	png->row[0] = 0;  // filter type none
+
+	qr_sink_init(&png->idat, write_idat, sink);
+	qr_deflate_init(png->deflate, QR_DEFLATE_ZLIB, QR_DEFLATE_FAST, &png->idat);
+}
+
+// the row is packed once and repeated for every pixel row
+void
+qr_png_put_rows(qr_png_writer *png, const qr_run *runs, size_t count, size_t repeat)
+{
+	size_t i;
+
+	qr_raster_draw_runs(png->qr, &png->options, QR_PIXEL_1BPP, png->row + 1, runs, count);
+
+	// a set bit is white in grayscale
+	for (i = 1; i <= png->row_bytes; ++i)
+		png->row[i] = ~png->row[i];
+
+	while (repeat--)
+		qr_deflate_write(png->deflate, png->row, png->row_bytes + 1);
+}
+
+void
+qr_png_end(qr_png_writer *png)
+{
+	qr_deflate_finish(png->deflate);
+	qr_sink_flush(&png->idat);
+	if (png->idat.error) png->out->error = 1;
+
+	write_chunk(png->out, "IEND", NULL, 0);
+
+	free(png->row);
+	free(png->deflate);
+}
+
+void
+qr_png_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink)
+{
+	size_t quiet_rows = options->quiet_zone * options->scale, i;
+	qr_run runs[QR_MAX_RUNS];
+	qr_png_writer png;
+
+	qr_png_begin(&png, qr, options, sink);
+	qr_png_put_rows(&png, NULL, 0, quiet_rows);
+	for (i = 0; i < qr->side_length; ++i)
+		qr_png_put_rows(&png, runs, qr_module_runs(qr, i, runs), options->scale);
+	qr_png_put_rows(&png, NULL, 0, quiet_rows);
+	qr_png_end(&png);
+}
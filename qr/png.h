@@ -0,0 +1,28 @@
+#ifndef QR_PNG_H
+#define QR_PNG_H
+
+#include <qr/deflate.h>
+#include <qr/matrix.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+	const qr_code *qr;
+	qr_raster_options options;
+	qr_sink *out;
+	qr_sink idat;  // every flush becomes one IDAT chunk
+	qr_deflate *deflate;
+	uint8_t *row;  // filter type followed by the packed pixels
+	size_t row_bytes;
+} qr_png_writer;
+
+void qr_png_begin(qr_png_writer *png, const qr_code *qr, const qr_raster_options *options, qr_sink *sink);
+void qr_png_put_rows(qr_png_writer *png, const qr_run *runs, size_t count, size_t repeat);
+void qr_png_end(qr_png_writer *png);
+void qr_png_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink);
+
+#endif // QR_PNG_H
@@ -0,0 +1,34 @@
+#include <qr/pnm.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+
+// P4 for 1-bit pixels, a set bit is black, or P5 for 8-bit gray
+void
+qr_pnm_put_header(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, qr_sink *sink)
+{
+	size_t size = qr_raster_size(qr, options);
+
+	qr_sink_puts(sink, format == QR_PIXEL_1BPP ? "P4\n" : "P5\n");
+	qr_sink_put_uint(sink, size);
+	qr_sink_putc(sink, ' ');
+	qr_sink_put_uint(sink, size);
+	qr_sink_putc(sink, '\n');
+	if (format != QR_PIXEL_1BPP)
+		qr_sink_puts(sink, "255\n");
+}
+
+void
+qr_pbm_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink)
+{
+	qr_pnm_put_header(qr, options, QR_PIXEL_1BPP, sink);
+	qr_raster_stream(qr, options, QR_PIXEL_1BPP, sink);
+}
+
+void
+qr_pgm_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink)
+{
+	qr_pnm_put_header(qr, options, QR_PIXEL_GRAY8, sink);
+	qr_raster_stream(qr, options, QR_PIXEL_GRAY8, sink);
+}
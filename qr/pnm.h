@@ -0,0 +1,12 @@
+#ifndef QR_PNM_H
+#define QR_PNM_H
+
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+
+void qr_pnm_put_header(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, qr_sink *sink);
+void qr_pbm_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink);
+void qr_pgm_render(const qr_code *qr, const qr_raster_options *options, qr_sink *sink);
+
+#endif // QR_PNM_H
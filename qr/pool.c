@@ -0,0 +1,171 @@
+#include <pthread.h>
+#include <qr/pool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+static int
+take(qr_pool_deque *deque, size_t *job)
+{
+	int found;
+
+	pthread_mutex_lock(&deque->lock);
+	found = deque->first < deque->last;
+	if (found) *job = deque->first++;
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+// moves the back half of the first non-empty deque after the worker's own
+// into its own deque, which only its owner refills
+static int
+steal(qr_pool *pool, unsigned worker)
+{
+	size_t first = 0, last = 0;
+	unsigned i;
+
+	for (i = 1; i < pool->count && first == last; ++i)
+	{
+		qr_pool_deque *victim = &pool->deques[(worker + i) % pool->count];
+
+		pthread_mutex_lock(&victim->lock);
+		last = victim->last;
+		first = victim->last -= (victim->last - victim->first + 1) / 2;
+		pthread_mutex_unlock(&victim->lock);
+	}
+
+	if (first == last) return 0;
+
+	pthread_mutex_lock(&pool->deques[worker].lock);
+	pool->deques[worker].first = first;
+	pool->deques[worker].last = last;
+	pthread_mutex_unlock(&pool->deques[worker].lock);
+
+	return 1;
+}
+
+static void
+work(qr_pool *pool, unsigned worker)
+{
+	size_t job;
+
+	do
+	{
+		while (take(&pool->deques[worker], &job))
+			pool->job(pool->context, worker, job);
+	}
+	while (steal(pool, worker));
+}
+
+static void *
+worker_main(void *arg)
+{
+	qr_pool_worker *worker = arg;
+	qr_pool *pool = worker->pool;
+	unsigned generation = 0;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&pool->lock);
+		while (!pool->stop && pool->generation == generation)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		generation = pool->generation;
+		if (pool->stop)
+		{
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		pthread_mutex_unlock(&pool->lock);
+
+		work(pool, worker->index);
+
+		pthread_mutex_lock(&pool->lock);
+		if (!--pool->busy)
+			pthread_cond_signal(&pool->finish);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+// starts up to count - 1 threads next to the calling thread, returns the
+// number of workers, fewer if a thread could not be started
+unsigned
+qr_pool_init(qr_pool *pool, unsigned count)
+{
+	unsigned i;
+
+	if (!count) count = 1;
+
+	pool->workers = malloc(count * sizeof(*pool->workers));
+	pool->deques = malloc(count * sizeof(*pool->deques));
+	pool->generation = 0;
+	pool->busy = 0;
+	pool->stop = 0;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->finish, NULL);
+
+	for (i = 0; i < count; ++i)
+	{
+		pool->workers[i] = (qr_pool_worker) { pool, i, pthread_self() };
+		if (i && pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]))
+			break;
+	}
+
+	// the deques are only used by qr_pool_run, after the count is known
+	for (pool->count = i, i = 0; i < pool->count; ++i)
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+	return pool->count;
+}
+
+// runs jobs 0 to count - 1, each worker starts with a contiguous range of
+// them, and returns when all are done
+void
+qr_pool_run(qr_pool *pool, size_t count, qr_pool_job job, void *context)
+{
+	unsigned i;
+
+	for (i = 0; i < pool->count; ++i)
+	{
+		pool->deques[i].first = count * i / pool->count;
+		pool->deques[i].last = count * (i + 1) / pool->count;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->context = context;
+	pool->busy = pool->count - 1;
+	++pool->generation;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	work(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->busy)
+		pthread_cond_wait(&pool->finish, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void
+qr_pool_destroy(qr_pool *pool)
+{
+	unsigned i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->count; ++i)
+	{
+		if (i) pthread_join(pool->workers[i].thread, NULL);
+		pthread_mutex_destroy(&pool->deques[i].lock);
+	}
+
+	free(pool->workers);
+	free(pool->deques);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->finish);
+}
@@ -0,0 +1,45 @@
+#ifndef QR_POOL_H
+#define QR_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+typedef void (*qr_pool_job)(void *context, unsigned worker, size_t job);
+
+// the jobs a worker has not started yet, the owner takes them from the
+// front and other workers steal from the back
+typedef struct
+{
+	pthread_mutex_t lock;
+	size_t first, last;
+} qr_pool_deque;
+
+typedef struct qr_pool qr_pool;
+
+typedef struct
+{
+	qr_pool *pool;
+	unsigned index;
+	pthread_t thread;
+} qr_pool_worker;
+
+struct qr_pool
+{
+	unsigned count;  // workers, the calling thread is worker 0
+	qr_pool_worker *workers;
+	qr_pool_deque *deques;
+
+	pthread_mutex_t lock;
+	pthread_cond_t start, finish;
+	unsigned generation, busy;
+	int stop;
+
+	qr_pool_job job;
+	void *context;
+};
+
+unsigned qr_pool_init(qr_pool *pool, unsigned count);
+void qr_pool_run(qr_pool *pool, size_t count, qr_pool_job job, void *context);
+void qr_pool_destroy(qr_pool *pool);
+
+#endif // QR_POOL_H
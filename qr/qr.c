@@ -4,11 +4,20 @@
 #include <qr/mask.h>
 #include <qr/matrix.h>
 #include <qr/patterns.h>
+#include <qr/pdf.h>
+#include <qr/png.h>
+#include <qr/pnm.h>
 #include <qr/qr.h>
+#include <qr/raster.h>
+#include <qr/rects.h>
+#include <qr/sheet.h>
+#include <qr/sink.h>
+#include <qr/text.h>
 #include <qr/types.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 extern void log_(const char *fmt, ...);
 
@@ -34,9 +43,33 @@ qr_create(qr_ec_level level, qr_encoding_mode mode, unsigned version)
 	qr->codeword_count = CODEWORD_COUNT[qr->version];
 	qr->codewords = malloc(qr->codeword_count * sizeof(word));
 
+	qr->capacity = version;
+	qr->ec_pool = NULL;
+
 	return qr;
 }
 
+// prepares a symbol for another message, its buffers only grow if the new
+// version is larger than all before
+void
+qr_reset(qr_code *qr, qr_ec_level level, qr_encoding_mode mode, unsigned version)
+{
+	qr->level = level;
+	qr->mode = mode;
+	qr->version = version;
+	qr->side_length = 21 + (qr->version * 4);
+	qr->codeword_count = CODEWORD_COUNT[qr->version];
+
+	if (version > qr->capacity)
+	{
+		qr->capacity = version;
+		free(qr->matrix);
+		free(qr->codewords);
+		qr->matrix = malloc((qr->side_length * qr->side_length) * sizeof(*qr->matrix));
+		qr->codewords = malloc(qr->codeword_count * sizeof(word));
+	}
+}
+
 void
 qr_destroy(qr_code *qr)
 {
@@ -47,15 +80,22 @@ qr_destroy(qr_code *qr)
 
 void
 qr_encode_message(qr_code *qr, const char *message)
+{
+	qr_segment segment = { .mode = qr->mode, .data = message, .length = strlen(message) };
+	qr_encode_segments(qr, &segment, 1);
+}
+
+void
+qr_encode_segments(qr_code *qr, const qr_segment *segments, size_t count)
 {
 	// 1. enc
 	log_("Encoding message............");
-	qr_encode_data(qr, message);
+	qr_encode_data(qr, segments, count);
 	log_("OK\n");
 
 	// 2. ecc
 	log_("Encoding error correction...");
-	qr_ec_encode(qr);
+	qr_ec_encode_parallel(qr, qr->ec_pool);
 	log_("OK\n");
 
 	// 3. block
@@ -84,28 +124,388 @@ qr_encode_message(qr_code *qr, const char *message)
 	log_("OK\n");
 }
 
-void
-qr_svg_print(qr_code *qr, FILE *stream)
+static void
+svg_render_header(qr_sink *sink, size_t width, size_t height, qr_svg_style style)
+{
+	qr_sink_puts(sink, "<svg xmlns=\"http://www.w3.org/2000/svg\"");
+	if (style == QR_SVG_DEFS) qr_sink_puts(sink, " xmlns:xlink=\"http://www.w3.org/1999/xlink\"");
+	qr_sink_puts(sink, " width=\"");
+	qr_sink_put_uint(sink, width);
+	qr_sink_puts(sink, "\" height=\"");
+	qr_sink_put_uint(sink, height);
+	qr_sink_puts(sink, "\" viewBox=\"0 0 ");
+	qr_sink_put_uint(sink, width);
+	qr_sink_putc(sink, ' ');
+	qr_sink_put_uint(sink, height);
+	qr_sink_puts(sink, "\" shape-rendering=\"crispEdges\">\n");
+	qr_sink_puts(sink, "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n");
+
+	// finder and alignment patterns as rings filled with the even-odd rule
+	if (style == QR_SVG_DEFS)
+	{
+		qr_sink_puts(sink, "<defs>\n");
+		qr_sink_puts(sink, "<path id=\"qrf\" fill-rule=\"evenodd\" d=\"M0 0h7v7h-7zM1 1h5v5h-5zM2 2h3v3h-3z\"/>\n");
+		qr_sink_puts(sink, "<path id=\"qra\" fill-rule=\"evenodd\" d=\"M0 0h5v5h-5zM1 1h3v3h-3zM2 2h1v1h-1z\"/>\n");
+		qr_sink_puts(sink, "</defs>\n");
+	}
+}
+
+static void
+svg_render_rects(const qr_code *qr, qr_sink *sink, size_t x, size_t y)
 {
 	size_t i, j;
-	char *color;
-	char *fmt_str =
-		"<svg xmlns=\"http://www.w3.org/2000/svg\" "
-		"width=\"%zu\" height=\"%zu\" viewBox=\"0 0 %zu %zu\" "
-		"shape-rendering=\"crispEdges\">\n";
+
+	for (i = 0; i < qr->side_length; ++i)
+	{
+		for (j = 0; j < qr->side_length; ++j)
+		{
+			qr_sink_puts(sink, "<rect x=\"");
+			qr_sink_put_uint(sink, j + x);
+			qr_sink_puts(sink, "\" y=\"");
+			qr_sink_put_uint(sink, i + y);
+			qr_sink_puts(sink, qr_module_get(qr, i, j) ? "\" width=1 height=1 fill=\"black\"/>\n" : "\" width=1 height=1 fill=\"white\"/>\n");
+		}
+	}
+}
+
+static void
+svg_put_run(qr_sink *sink, size_t x, size_t y, size_t length)
+{
+	qr_sink_putc(sink, 'M');
+	qr_sink_put_uint(sink, x);
+	qr_sink_putc(sink, ' ');
+	qr_sink_put_uint(sink, y);
+	qr_sink_putc(sink, 'h');
+	qr_sink_put_uint(sink, length);
+	qr_sink_puts(sink, "v1h-");
+	qr_sink_put_uint(sink, length);
+	qr_sink_putc(sink, 'z');
+}
+
+static int
+svg_is_skipped(const qr_rect **skip, size_t count, size_t j)
+{
+	size_t k;
+
+	for (k = 0; k < count; ++k)
+		if (j >= skip[k]->x && j < skip[k]->x + skip[k]->width)
+			return 1;
+
+	return 0;
+}
+
+// skip holds the areas of modules drawn otherwise
+static void
+svg_render_path(const qr_code *qr, const qr_rect *skip, size_t skip_count, qr_sink *sink, size_t x, size_t y)
+{
+	const qr_rect *row_skip[QR_MAX_ALIGNMENT_PATTERNS + 3];
+	size_t i, j, k, run, row_skip_count;
+
+	// one closed subpath per horizontal run of dark modules, light modules are left to the background
+	qr_sink_puts(sink, "<path fill=\"black\" d=\"");
+	for (i = 0; i < qr->side_length; ++i)
+	{
+		for (row_skip_count = 0, k = 0; k < skip_count; ++k)
+			if (i >= skip[k].y && i < skip[k].y + skip[k].height)
+				row_skip[row_skip_count++] = &skip[k];
+
+		for (j = 0; j < qr->side_length; j += run)
+		{
+			for (run = 0; j + run < qr->side_length && qr_module_get(qr, i, j + run) && !svg_is_skipped(row_skip, row_skip_count, j + run); ++run);
+
+			if (!run)
+			{
+				run = 1;
+				continue;
+			}
+
+			svg_put_run(sink, j + x, i + y, run);
+		}
+	}
+	qr_sink_puts(sink, "\"/>\n");
+}
+
+static void
+svg_render_use(qr_sink *sink, const char *id, size_t x, size_t y)
+{
+	qr_sink_puts(sink, "<use xlink:href=\"#");
+	qr_sink_puts(sink, id);
+	qr_sink_puts(sink, "\" x=\"");
+	qr_sink_put_uint(sink, x);
+	qr_sink_puts(sink, "\" y=\"");
+	qr_sink_put_uint(sink, y);
+	qr_sink_puts(sink, "\"/>\n");
+}
+
+// instantiates the patterns from the definitions and draws only the
+// remaining modules as runs
+static void
+svg_render_uses(const qr_code *qr, qr_sink *sink, size_t x, size_t y)
+{
+	size_t origins[QR_MAX_ALIGNMENT_PATTERNS][2], count, k, n = qr->side_length;
+	qr_rect skip[QR_MAX_ALIGNMENT_PATTERNS + 3] =
+	{
+		{ 0, 0, 7, 7 }, { n - 7, 0, 7, 7 }, { 0, n - 7, 7, 7 },
+	};
+
+	count = qr_alignment_pattern_origins(qr, origins);
+	for (k = 0; k < count; ++k)
+	{
+		skip[3 + k] = (qr_rect) { origins[k][1], origins[k][0], 5, 5 };
+		svg_render_use(sink, "qra", origins[k][1] + x, origins[k][0] + y);
+	}
+	for (k = 0; k < 3; ++k)
+		svg_render_use(sink, "qrf", skip[k].x + x, skip[k].y + y);
+
+	svg_render_path(qr, skip, 3 + count, sink, x, y);
+}
+
+static void
+svg_render_modules(const qr_code *qr, qr_svg_style style, qr_sink *sink, size_t x, size_t y)
+{
+	switch (style)
+	{
+	case QR_SVG_RECT: svg_render_rects(qr, sink, x, y); break;
+	case QR_SVG_PATH: svg_render_path(qr, NULL, 0, sink, x, y); break;
+	case QR_SVG_DEFS: svg_render_uses(qr, sink, x, y); break;
+	}
+}
+
+void
+qr_svg_render(const qr_code *qr, qr_svg_style style, qr_sink *sink)
+{
 	size_t total_side_length = qr->side_length + 8;  // added quiet zone padding
 
-	fprintf(stream, fmt_str, total_side_length, total_side_length, total_side_length, total_side_length);
-	fprintf(stream, "<rect width=\"100%%\" height=\"100%%\" fill=\"white\"/>\n");
+	svg_render_header(sink, total_side_length, total_side_length, style);
+	svg_render_modules(qr, style, sink, 4, 4);
+	qr_sink_puts(sink, "</svg>\n");
+}
+
+// places the symbols next to each other, each with its own quiet zone
+void
+qr_svg_render_set(qr_code **symbols, size_t count, qr_svg_style style, qr_sink *sink)
+{
+	size_t i, width = 0, height = 0;
+
+	for (i = 0; i < count; ++i)
+	{
+		width += symbols[i]->side_length + 8;
+		if (symbols[i]->side_length + 8 > height)
+			height = symbols[i]->side_length + 8;
+	}
+
+	svg_render_header(sink, width, height, style);
+	for (i = 0, width = 0; i < count; ++i)
+	{
+		svg_render_modules(symbols[i], style, sink, width + 4, 4);
+		width += symbols[i]->side_length + 8;
+	}
+	qr_sink_puts(sink, "</svg>\n");
+}
+
+static void
+svg_put_escaped(qr_sink *sink, const char *text, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; ++i)
+	{
+		switch (text[i])
+		{
+		case '&': qr_sink_puts(sink, "&amp;"); break;
+		case '<': qr_sink_puts(sink, "&lt;"); break;
+		case '>': qr_sink_puts(sink, "&gt;"); break;
+		default:  qr_sink_putc(sink, text[i]); break;
+		}
+	}
+}
+
+// lays the symbols out on a grid of pages stacked vertically in one
+// document, each symbol is scaled from module units into points
+int
+qr_svg_render_sheet(qr_code **symbols, const char **captions, size_t count, qr_svg_style style, const qr_sheet_options *options, qr_sink *sink)
+{
+	qr_sheet_layout layout;
+	size_t i, page, x, y, length;
+
+	if (qr_sheet_layout_compute(symbols, count, options, &layout)) return -1;
+
+	svg_render_header(sink, options->page_width, layout.pages * options->page_height, style);
+	for (i = 0; i < count; ++i)
+	{
+		qr_sheet_place(&layout, options, symbols[i], i, &page, &x, &y);
+		qr_sink_puts(sink, "<g transform=\"translate(");
+		qr_sink_put_uint(sink, x);
+		qr_sink_putc(sink, ' ');
+		qr_sink_put_uint(sink, y + page * options->page_height);
+		qr_sink_puts(sink, ") scale(");
+		qr_sink_put_uint(sink, options->module);
+		qr_sink_puts(sink, ")\">\n");
+		svg_render_modules(symbols[i], style, sink, options->quiet_zone, options->quiet_zone);
+		qr_sink_puts(sink, "</g>\n");
+
+		if (!options->caption_size || !captions || !captions[i]) continue;
+
+		qr_sheet_caption(&layout, options, i, captions[i], &x, &y, &length);
+		qr_sink_puts(sink, "<text x=\"");
+		qr_sink_put_uint(sink, x);
+		qr_sink_puts(sink, "\" y=\"");
+		qr_sink_put_uint(sink, y + page * options->page_height);
+		qr_sink_puts(sink, "\" font-family=\"monospace\" font-size=\"");
+		qr_sink_put_uint(sink, options->caption_size);
+		qr_sink_puts(sink, "\">");
+		svg_put_escaped(sink, captions[i], length);
+		qr_sink_puts(sink, "</text>\n");
+	}
+	qr_sink_puts(sink, "</svg>\n");
+
+	return 0;
+}
+
+void
+qr_svg_print(qr_code *qr, qr_svg_style style, FILE *stream)
+{
+	qr_sink sink;
+
+	qr_sink_file(&sink, stream);
+	qr_svg_render(qr, style, &sink);
+	qr_sink_flush(&sink);
+}
+
+void
+qr_svg_print_set(qr_code **symbols, size_t count, qr_svg_style style, FILE *stream)
+{
+	qr_sink sink;
+
+	qr_sink_file(&sink, stream);
+	qr_svg_render_set(symbols, count, style, &sink);
+	qr_sink_flush(&sink);
+}
+
+// PDF and EPS take the scale in points per module, text only the quiet zone
+// and SVG none of the raster options
+void
+qr_render(const qr_code *qr, qr_format format, const qr_raster_options *options, qr_sink *sink)
+{
+	switch (format)
+	{
+	case QR_FORMAT_SVG:      qr_svg_render(qr, QR_SVG_RECT, sink); break;
+	case QR_FORMAT_SVG_PATH: qr_svg_render(qr, QR_SVG_PATH, sink); break;
+	case QR_FORMAT_SVG_DEFS: qr_svg_render(qr, QR_SVG_DEFS, sink); break;
+	case QR_FORMAT_PNG:      qr_png_render(qr, options, sink); break;
+	case QR_FORMAT_PBM:      qr_pbm_render(qr, options, sink); break;
+	case QR_FORMAT_PGM:      qr_pgm_render(qr, options, sink); break;
+	case QR_FORMAT_UTF8:     qr_text_render(qr, options->quiet_zone, 0, sink); break;
+	case QR_FORMAT_ANSI:     qr_text_render(qr, options->quiet_zone, 1, sink); break;
+	case QR_FORMAT_PDF:      qr_pdf_render(qr, options, sink); break;
+	case QR_FORMAT_EPS:      qr_eps_render(qr, options, sink); break;
+	}
+}
+
+// stores at most size bytes and returns the size of the whole output like
+// snprintf, nothing is allocated except by the png, pdf and eps writers
+size_t
+qr_render_buffer(const qr_code *qr, qr_format format, const qr_raster_options *options, void *buffer, size_t size)
+{
+	qr_buffer fixed = { buffer, 0, size };
+	qr_sink sink;
+
+	qr_sink_fixed(&sink, &fixed);
+	qr_render(qr, format, options, &sink);
+	qr_sink_flush(&sink);
+
+	return sink.written;
+}
+
+size_t
+qr_render_size(const qr_code *qr, qr_format format, const qr_raster_options *options)
+{
+	return qr_render_buffer(qr, format, options, NULL, 0);
+}
+
+// writes the rows of module row i, or of the quiet zone without runs
+static void
+render_target_rows(const qr_code *qr, const qr_render_target *target, qr_png_writer *png, const qr_run *runs, size_t count, size_t i)
+{
+	const qr_raster_options *options = &target->options;
+	size_t repeat = runs ? options->scale : options->quiet_zone * options->scale, k;
+
+	switch (target->format)
+	{
+	case QR_FORMAT_SVG_PATH:
+		for (k = 0; k < count; ++k)
+			svg_put_run(target->sink, runs[k].begin + 4, i + 4, runs[k].length);
+		break;
+
+	case QR_FORMAT_PNG: qr_png_put_rows(png, runs, count, repeat); break;
+	case QR_FORMAT_PBM: qr_raster_put_rows(qr, options, QR_PIXEL_1BPP, runs, count, repeat, target->sink); break;
+	case QR_FORMAT_PGM: qr_raster_put_rows(qr, options, QR_PIXEL_GRAY8, runs, count, repeat, target->sink); break;
+	default: break;
+	}
+}
+
+// renders every target in one pass over the module rows, the runs of dark
+// modules of a row are extracted once for all row ordered formats (svg-path,
+// png, pbm and pgm), the other formats are rendered on their own afterwards
+void
+qr_render_targets(const qr_code *qr, const qr_render_target *targets, size_t count)
+{
+	qr_png_writer *png = malloc(count * sizeof(*png));
+	qr_run runs[QR_MAX_RUNS];
+	size_t i, t, run_count;
+
+	for (t = 0; t < count; ++t)
+	{
+		switch (targets[t].format)
+		{
+		case QR_FORMAT_SVG_PATH:
+			svg_render_header(targets[t].sink, qr->side_length + 8, qr->side_length + 8, QR_SVG_PATH);
+			qr_sink_puts(targets[t].sink, "<path fill=\"black\" d=\"");
+			break;
+
+		case QR_FORMAT_PNG: qr_png_begin(&png[t], qr, &targets[t].options, targets[t].sink); break;
+		case QR_FORMAT_PBM: qr_pnm_put_header(qr, &targets[t].options, QR_PIXEL_1BPP, targets[t].sink); break;
+		case QR_FORMAT_PGM: qr_pnm_put_header(qr, &targets[t].options, QR_PIXEL_GRAY8, targets[t].sink); break;
+		default: break;
+		}
+
+		render_target_rows(qr, &targets[t], &png[t], NULL, 0, 0);
+	}
 
 	for (i = 0; i < qr->side_length; ++i)
 	{
-		for (j = 0; j < qr->side_length; ++j)
+		run_count = qr_module_runs(qr, i, runs);
+		for (t = 0; t < count; ++t)
+			render_target_rows(qr, &targets[t], &png[t], runs, run_count, i);
+	}
+
+	for (t = 0; t < count; ++t)
+	{
+		render_target_rows(qr, &targets[t], &png[t], NULL, 0, 0);
+
+		switch (targets[t].format)
 		{
-			color = qr_module_get(qr, i, j) ? "black" : "white";
-			fprintf(stream, "<rect x=\"%zu\" y=\"%zu\" width=1 height=1 fill=\"%s\"/>\n", j + 4, i + 4, color);
+		case QR_FORMAT_SVG_PATH: qr_sink_puts(targets[t].sink, "\"/>\n</svg>\n"); break;
+		case QR_FORMAT_PNG:      qr_png_end(&png[t]); break;
+		case QR_FORMAT_PBM:      break;
+		case QR_FORMAT_PGM:      break;
+		default:                 qr_render(qr, targets[t].format, &targets[t].options, targets[t].sink); break;
 		}
 	}
 
-	fprintf(stream, "</svg>\n");
+	free(png);
+}
+
+// only vector formats have pages
+int
+qr_render_sheet(qr_code **symbols, const char **captions, size_t count, qr_format format, const qr_sheet_options *options, qr_sink *sink)
+{
+	switch (format)
+	{
+	case QR_FORMAT_SVG:      return qr_svg_render_sheet(symbols, captions, count, QR_SVG_RECT, options, sink);
+	case QR_FORMAT_SVG_PATH: return qr_svg_render_sheet(symbols, captions, count, QR_SVG_PATH, options, sink);
+	case QR_FORMAT_SVG_DEFS: return qr_svg_render_sheet(symbols, captions, count, QR_SVG_DEFS, options, sink);
+	case QR_FORMAT_PDF:      return qr_pdf_render_sheet(symbols, captions, count, options, sink);
+	default:                 return -1;
+	}
 }
@@ -1,12 +1,55 @@
 #ifndef QR_QR_H
 #define QR_QR_H
 
+#include <qr/raster.h>
+#include <qr/sheet.h>
+#include <qr/sink.h>
 #include <qr/types.h>
+#include <stddef.h>
 #include <stdio.h>
 
+typedef enum
+{
+	QR_SVG_RECT,
+	QR_SVG_PATH,
+	QR_SVG_DEFS,
+} qr_svg_style;
+
+typedef enum
+{
+	QR_FORMAT_SVG,
+	QR_FORMAT_SVG_PATH,
+	QR_FORMAT_SVG_DEFS,
+	QR_FORMAT_PNG,
+	QR_FORMAT_PBM,
+	QR_FORMAT_PGM,
+	QR_FORMAT_UTF8,
+	QR_FORMAT_ANSI,
+	QR_FORMAT_PDF,
+	QR_FORMAT_EPS,
+} qr_format;
+
+typedef struct
+{
+	qr_format format;
+	qr_raster_options options;
+	qr_sink *sink;
+} qr_render_target;
+
 qr_code *qr_create(qr_ec_level level, qr_encoding_mode mode, unsigned version);
+void qr_reset(qr_code *qr, qr_ec_level level, qr_encoding_mode mode, unsigned version);
 void qr_destroy(qr_code *qr);
 void qr_encode_message(qr_code *qr, const char *message);
-void qr_svg_print(qr_code *qr, FILE *stream);
+void qr_encode_segments(qr_code *qr, const qr_segment *segments, size_t count);
+void qr_svg_render(const qr_code *qr, qr_svg_style style, qr_sink *sink);
+void qr_svg_render_set(qr_code **symbols, size_t count, qr_svg_style style, qr_sink *sink);
+int qr_svg_render_sheet(qr_code **symbols, const char **captions, size_t count, qr_svg_style style, const qr_sheet_options *options, qr_sink *sink);
+void qr_svg_print(qr_code *qr, qr_svg_style style, FILE *stream);
+void qr_svg_print_set(qr_code **symbols, size_t count, qr_svg_style style, FILE *stream);
+void qr_render(const qr_code *qr, qr_format format, const qr_raster_options *options, qr_sink *sink);
+void qr_render_targets(const qr_code *qr, const qr_render_target *targets, size_t count);
+size_t qr_render_buffer(const qr_code *qr, qr_format format, const qr_raster_options *options, void *buffer, size_t size);
+size_t qr_render_size(const qr_code *qr, qr_format format, const qr_raster_options *options);
+int qr_render_sheet(qr_code **symbols, const char **captions, size_t count, qr_format format, const qr_sheet_options *options, qr_sink *sink);
 
 #endif // QR_QR_H
@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <qr/matrix.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+size_t
+qr_raster_size(const qr_code *qr, const qr_raster_options *options)
+{
+	return (qr->side_length + 2 * options->quiet_zone) * options->scale;
+}
+
+size_t
+qr_raster_row_bytes(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format)
+{
+	size_t size = qr_raster_size(qr, options);
+
+	switch (format)
+	{
+	case QR_PIXEL_1BPP:   return (size + 7) / 8;
+	case QR_PIXEL_GRAY8:  return size;
+	case QR_PIXEL_RGBA32: return 4 * size;
+	}
+
+	return 0;
+}
+
+// fills pixels [begin, end) of a framebuffer row
+static void
+fill_span(qr_pixel_format format, uint8_t *row, size_t begin, size_t end, int dark)
+{
+	static const uint8_t RGBA[2][4] = { { 0xFF, 0xFF, 0xFF, 0xFF }, { 0x00, 0x00, 0x00, 0xFF } };
+	size_t x;
+
+	switch (format)
+	{
+	case QR_PIXEL_1BPP:
+		// partial bytes bit by bit, whole bytes at once
+		for (x = begin; x < end && x % 8; ++x)
+			row[x / 8] = dark ? row[x / 8] | (0x80 >> (x % 8)) : row[x / 8] & ~(0x80 >> (x % 8));
+		if (end - x >= 8)
+		{
+			memset(row + x / 8, dark ? 0xFF : 0x00, (end - x) / 8);
+			x += (end - x) & ~(size_t) 7;
+		}
+		for (; x < end; ++x)
+			row[x / 8] = dark ? row[x / 8] | (0x80 >> (x % 8)) : row[x / 8] & ~(0x80 >> (x % 8));
+		break;
+
+	case QR_PIXEL_GRAY8:
+		memset(row + begin, dark ? 0x00 : 0xFF, end - begin);
+		break;
+
+	case QR_PIXEL_RGBA32:
+		for (x = begin; x < end; ++x)
+			memcpy(row + 4 * x, RGBA[dark], 4);
+		break;
+	}
+}
+
+// draws pixels [from, to) of a pixel row of the symbol and its quiet zone
+// starting at pixel x of row, from the dark runs of its module row
+static void
+draw_runs(const qr_raster_options *options, qr_pixel_format format, uint8_t *row, size_t x, size_t from, size_t to, const qr_run *runs, size_t count)
+{
+	size_t k, begin, end;
+
+	fill_span(format, row, x, x + to - from, 0);
+	for (k = 0; k < count; ++k)
+	{
+		begin = (options->quiet_zone + runs[k].begin) * options->scale;
+		end = begin + runs[k].length * options->scale;
+		if (begin >= to) break;
+
+		if (begin < from) begin = from;
+		if (end > to) end = to;
+		if (begin < end)
+			fill_span(format, row, x + begin - from, x + end - from, 1);
+	}
+}
+
+// draws pixels [from, to) of pixel row y of the symbol and its quiet zone
+// starting at pixel x of row
+static void
+draw_row(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, uint8_t *row, size_t x, size_t from, size_t to, size_t y)
+{
+	size_t i = y / options->scale, count = 0;
+	qr_run runs[QR_MAX_RUNS];
+
+	if (i >= options->quiet_zone && i < options->quiet_zone + qr->side_length)
+		count = qr_module_runs(qr, i - options->quiet_zone, runs);
+
+	draw_runs(options, format, row, x, from, to, runs, count);
+}
+
+// pixel rows from y on that are drawn the same, quiet zone rows above and
+// below the symbol are grouped
+static size_t
+row_repeat(const qr_code *qr, const qr_raster_options *options, size_t y)
+{
+	size_t size = qr_raster_size(qr, options);
+
+	if (y < options->quiet_zone * options->scale || y >= size - options->quiet_zone * options->scale)
+		return options->quiet_zone * options->scale;
+
+	return options->scale;
+}
+
+// packs pixel row y with one bit per pixel, most significant bit first and
+// dark pixels set, padding bits at the end of the row are cleared
+void
+qr_raster_pack_row(const qr_code *qr, const qr_raster_options *options, size_t y, uint8_t *row)
+{
+	memset(row, 0, qr_raster_row_bytes(qr, options, QR_PIXEL_1BPP));
+	draw_row(qr, options, QR_PIXEL_1BPP, row, 0, 0, qr_raster_size(qr, options), y);
+}
+
+// draws the symbol and its quiet zone with the top left corner at x, y,
+// pixels outside of the framebuffer are clipped
+void
+qr_raster_blit(const qr_code *qr, const qr_raster_options *options, qr_framebuffer *framebuffer, size_t x, size_t y)
+{
+	size_t size = qr_raster_size(qr, options), width, height, py;
+
+	assert(options->scale > 0);
+
+	if (x >= framebuffer->width || y >= framebuffer->height) return;
+	width = framebuffer->width - x < size ? framebuffer->width - x : size;
+	height = framebuffer->height - y < size ? framebuffer->height - y : size;
+
+	for (py = 0; py < height; ++py)
+		draw_row(qr, options, framebuffer->format, (uint8_t *) framebuffer->pixels + (y + py) * framebuffer->stride, x, 0, width, py);
+}
+
+void
+qr_scanline_init(qr_scanline *scanline, const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, uint8_t *row)
+{
+	assert(options->scale > 0);
+
+	scanline->qr = qr;
+	scanline->options = options;
+	scanline->format = format;
+	scanline->row = row;
+	scanline->y = 0;
+}
+
+// expands the next distinct pixel row and returns how many consecutive
+// pixel rows it stands for, 0 after the last row
+size_t
+qr_scanline_next(qr_scanline *scanline)
+{
+	size_t size = qr_raster_size(scanline->qr, scanline->options), count;
+
+	if (scanline->y >= size) return 0;
+	count = row_repeat(scanline->qr, scanline->options, scanline->y);
+
+	// clears the padding bits
+	if (scanline->format == QR_PIXEL_1BPP)
+		scanline->row[qr_raster_row_bytes(scanline->qr, scanline->options, scanline->format) - 1] = 0;
+	draw_row(scanline->qr, scanline->options, scanline->format, scanline->row, 0, 0, size, scanline->y);
+
+	scanline->y += count;
+	return count;
+}
+
+// draws a whole pixel row from the dark runs of its module row, padding
+// bits at the end of a 1-bit row are cleared
+void
+qr_raster_draw_runs(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, uint8_t *row, const qr_run *runs, size_t count)
+{
+	if (format == QR_PIXEL_1BPP)
+		row[qr_raster_row_bytes(qr, options, format) - 1] = 0;
+	draw_runs(options, format, row, 0, 0, qr_raster_size(qr, options), runs, count);
+}
+
+// writes repeat identical pixel rows drawn from the dark runs of a module
+// row without allocating, rows wider than the chunk are drawn piece by piece
+void
+qr_raster_put_rows(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, const qr_run *runs, size_t count, size_t repeat, qr_sink *sink)
+{
+	uint8_t chunk[QR_RASTER_CHUNK_SIZE];
+	size_t size = qr_raster_size(qr, options), row_bytes = qr_raster_row_bytes(qr, options, format);
+	size_t pixels = format == QR_PIXEL_1BPP ? 8 * sizeof(chunk) : format == QR_PIXEL_GRAY8 ? sizeof(chunk) : sizeof(chunk) / 4;
+	size_t k, from, offset;
+
+	assert(options->scale > 0);
+	if (!repeat) return;
+
+	// a row that fits is drawn once for all its repeats
+	if (row_bytes <= sizeof(chunk))
+	{
+		qr_raster_draw_runs(qr, options, format, chunk, runs, count);
+		for (k = 0; k < repeat; ++k)
+			qr_sink_put(sink, chunk, row_bytes);
+		return;
+	}
+
+	for (k = 0; k < repeat; ++k)
+	{
+		for (from = 0, offset = 0; from < size; from += pixels, offset += sizeof(chunk))
+		{
+			// clears the padding bits of the last piece
+			if (format == QR_PIXEL_1BPP) memset(chunk, 0, sizeof(chunk));
+			draw_runs(options, format, chunk, 0, from, from + pixels < size ? from + pixels : size, runs, count);
+			qr_sink_put(sink, chunk, row_bytes - offset < sizeof(chunk) ? row_bytes - offset : sizeof(chunk));
+		}
+	}
+}
+
+// writes the raw pixel rows one after another, module row by module row
+void
+qr_raster_stream(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, qr_sink *sink)
+{
+	size_t quiet_rows = options->quiet_zone * options->scale, i;
+	qr_run runs[QR_MAX_RUNS];
+
+	qr_raster_put_rows(qr, options, format, NULL, 0, quiet_rows, sink);
+	for (i = 0; i < qr->side_length; ++i)
+		qr_raster_put_rows(qr, options, format, runs, qr_module_runs(qr, i, runs), options->scale, sink);
+	qr_raster_put_rows(qr, options, format, NULL, 0, quiet_rows, sink);
+}
@@ -0,0 +1,54 @@
+#ifndef QR_RASTER_H
+#define QR_RASTER_H
+
+#include <qr/matrix.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define QR_QUIET_ZONE 4
+#define QR_RASTER_CHUNK_SIZE 4096  // bytes of a pixel row streamed at once
+
+typedef struct
+{
+	size_t scale;       // pixels per module
+	size_t quiet_zone;  // light modules around the symbol
+} qr_raster_options;
+
+typedef enum
+{
+	QR_PIXEL_1BPP,    // most significant bit first, a set bit is dark
+	QR_PIXEL_GRAY8,   // 0x00 dark, 0xFF light
+	QR_PIXEL_RGBA32,  // bytes R, G, B, A
+} qr_pixel_format;
+
+typedef struct
+{
+	void *pixels;
+	size_t width;
+	size_t height;
+	size_t stride;  // bytes from one row to the next
+	qr_pixel_format format;
+} qr_framebuffer;
+
+typedef struct
+{
+	const qr_code *qr;
+	const qr_raster_options *options;
+	qr_pixel_format format;
+	uint8_t *row;  // holds qr_raster_row_bytes() for the format
+	size_t y;      // next pixel row
+} qr_scanline;
+
+size_t qr_raster_size(const qr_code *qr, const qr_raster_options *options);
+size_t qr_raster_row_bytes(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format);
+void qr_raster_pack_row(const qr_code *qr, const qr_raster_options *options, size_t y, uint8_t *row);
+void qr_raster_blit(const qr_code *qr, const qr_raster_options *options, qr_framebuffer *framebuffer, size_t x, size_t y);
+void qr_scanline_init(qr_scanline *scanline, const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, uint8_t *row);
+size_t qr_scanline_next(qr_scanline *scanline);
+void qr_raster_draw_runs(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, uint8_t *row, const qr_run *runs, size_t count);
+void qr_raster_put_rows(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, const qr_run *runs, size_t count, size_t repeat, qr_sink *sink);
+void qr_raster_stream(const qr_code *qr, const qr_raster_options *options, qr_pixel_format format, qr_sink *sink);
+
+#endif // QR_RASTER_H
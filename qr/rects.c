@@ -0,0 +1,53 @@
+#include <qr/matrix.h>
+#include <qr/rects.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+is_free(const qr_code *qr, const char *covered, size_t i, size_t j)
+{
+	return qr_module_get(qr, i, j) && !covered[i * qr->side_length + j];
+}
+
+// covers the dark modules with disjoint rectangles: in reading order every
+// uncovered dark module starts the widest horizontal run of uncovered dark
+// modules, which then grows downwards as long as the rows below are dark
+// and uncovered across its whole width
+qr_rect *
+qr_rects_merge(const qr_code *qr, size_t *count)
+{
+	size_t n = qr->side_length, i, j, k, width, height;
+	char *covered = calloc(n * n, 1);
+	// a row starts at most one rectangle per two modules
+	qr_rect *rects = malloc(n * ((n + 1) / 2) * sizeof(*rects));
+
+	*count = 0;
+	for (i = 0; i < n; ++i)
+	{
+		for (j = 0; j < n; j += width)
+		{
+			for (width = 0; j + width < n && is_free(qr, covered, i, j + width); ++width);
+			if (!width)
+			{
+				width = 1;
+				continue;
+			}
+
+			for (height = 1; i + height < n; ++height)
+			{
+				for (k = 0; k < width && is_free(qr, covered, i + height, j + k); ++k);
+				if (k < width) break;
+			}
+
+			for (k = 0; k < height; ++k)
+				memset(covered + (i + k) * n + j, 1, width);
+
+			rects[(*count)++] = (qr_rect) { j, i, width, height };
+		}
+	}
+
+	free(covered);
+	return rects;
+}
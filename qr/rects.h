@@ -0,0 +1,15 @@
+#ifndef QR_RECTS_H
+#define QR_RECTS_H
+
+#include <qr/types.h>
+#include <stddef.h>
+
+typedef struct
+{
+	size_t x, y;  // column and row of the top left module
+	size_t width, height;
+} qr_rect;
+
+qr_rect *qr_rects_merge(const qr_code *qr, size_t *count);
+
+#endif // QR_RECTS_H
@@ -0,0 +1,67 @@
+#include <qr/sheet.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <string.h>
+
+// captions are set in a monospaced font with glyphs 0.6 em wide
+#define GLYPH_WIDTH(size) ((size) * 3 / 5)
+
+int
+qr_sheet_layout_compute(qr_code **symbols, size_t count, const qr_sheet_options *options, qr_sheet_layout *layout)
+{
+	size_t i, side = 0, per_page;
+
+	for (i = 0; i < count; ++i)
+		if (symbols[i]->side_length > side)
+			side = symbols[i]->side_length;
+
+	layout->box = (side + 2 * options->quiet_zone) * options->module;
+	layout->cell_width = layout->box;
+	layout->cell_height = layout->box + options->caption_size * 3 / 2;
+
+	if (options->page_width < 2 * options->margin + layout->cell_width) return -1;
+	if (options->page_height < 2 * options->margin + layout->cell_height) return -1;
+
+	layout->columns = (options->page_width - 2 * options->margin) / layout->cell_width;
+	layout->rows = (options->page_height - 2 * options->margin) / layout->cell_height;
+
+	per_page = layout->columns * layout->rows;
+	layout->pages = count ? (count + per_page - 1) / per_page : 1;
+
+	return 0;
+}
+
+// top left corner of the symbol's quiet zone, smaller symbols are centered in
+// the box of the largest one
+void
+qr_sheet_place(const qr_sheet_layout *layout, const qr_sheet_options *options, const qr_code *qr, size_t index, size_t *page, size_t *x, size_t *y)
+{
+	size_t per_page = layout->columns * layout->rows, cell = index % per_page;
+	size_t inset = (layout->box - (qr->side_length + 2 * options->quiet_zone) * options->module) / 2;
+
+	*page = index / per_page;
+	*x = options->margin + (cell % layout->columns) * layout->cell_width + inset;
+	*y = options->margin + (cell / layout->columns) * layout->cell_height + inset;
+}
+
+// start of the baseline of a caption centered below its symbol, and how many
+// bytes of it fit the cell
+void
+qr_sheet_caption(const qr_sheet_layout *layout, const qr_sheet_options *options, size_t index, const char *caption, size_t *x, size_t *y, size_t *length)
+{
+	size_t per_page = layout->columns * layout->rows, cell = index % per_page;
+	size_t glyph = GLYPH_WIDTH(options->caption_size) ? GLYPH_WIDTH(options->caption_size) : 1;
+
+	*length = strlen(caption);
+	if (*length > layout->cell_width / glyph)
+	{
+		*length = layout->cell_width / glyph;
+
+		// do not split a UTF-8 sequence
+		while (*length && (caption[*length] & 0xC0) == 0x80)
+			--*length;
+	}
+
+	*x = options->margin + (cell % layout->columns) * layout->cell_width + (layout->cell_width - *length * glyph) / 2;
+	*y = options->margin + (cell / layout->columns) * layout->cell_height + layout->box + options->caption_size;
+}
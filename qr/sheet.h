@@ -0,0 +1,37 @@
+#ifndef QR_SHEET_H
+#define QR_SHEET_H
+
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+
+// A4 in points
+#define QR_SHEET_PAGE_WIDTH  595
+#define QR_SHEET_PAGE_HEIGHT 842
+#define QR_SHEET_MARGIN      36
+
+typedef struct
+{
+	size_t page_width;    // all lengths in points
+	size_t page_height;
+	size_t margin;
+	size_t module;        // points per module
+	size_t quiet_zone;    // modules around every symbol
+	size_t caption_size;  // font size of the captions, 0 for none
+} qr_sheet_options;
+
+typedef struct
+{
+	size_t box;           // largest symbol including its quiet zone
+	size_t cell_width;
+	size_t cell_height;   // box and caption
+	size_t columns;
+	size_t rows;
+	size_t pages;
+} qr_sheet_layout;
+
+int qr_sheet_layout_compute(qr_code **symbols, size_t count, const qr_sheet_options *options, qr_sheet_layout *layout);
+void qr_sheet_place(const qr_sheet_layout *layout, const qr_sheet_options *options, const qr_code *qr, size_t index, size_t *page, size_t *x, size_t *y);
+void qr_sheet_caption(const qr_sheet_layout *layout, const qr_sheet_options *options, size_t index, const char *caption, size_t *x, size_t *y, size_t *length);
+
+#endif // QR_SHEET_H
@@ -0,0 +1,152 @@
+#include <qr/sink.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void
+qr_sink_init(qr_sink *sink, qr_sink_write write, void *context)
+{
+	sink->write = write;
+	sink->context = context;
+	sink->error = 0;
+	sink->written = 0;
+	sink->used = 0;
+}
+
+static size_t
+file_write(void *context, const void *data, size_t size)
+{
+	return fwrite(data, 1, size, context);
+}
+
+void
+qr_sink_file(qr_sink *sink, FILE *stream)
+{
+	qr_sink_init(sink, file_write, stream);
+}
+
+static size_t
+memory_write(void *context, const void *data, size_t size)
+{
+	qr_buffer *buffer = context;
+	size_t capacity = buffer->capacity ? buffer->capacity : QR_SINK_BUFFER_SIZE;
+	char *grown;
+
+	while (capacity - buffer->length < size)
+		capacity *= 2;
+
+	if (capacity != buffer->capacity)
+	{
+		if (!(grown = realloc(buffer->data, capacity))) return 0;
+		buffer->data = grown;
+		buffer->capacity = capacity;
+	}
+
+	memcpy(buffer->data + buffer->length, data, size);
+	buffer->length += size;
+	return size;
+}
+
+void
+qr_sink_memory(qr_sink *sink, qr_buffer *buffer)
+{
+	qr_sink_init(sink, memory_write, buffer);
+}
+
+// stores what fits and drops the rest, written still counts all of it
+static size_t
+fixed_write(void *context, const void *data, size_t size)
+{
+	qr_buffer *buffer = context;
+	size_t stored = buffer->capacity - buffer->length < size ? buffer->capacity - buffer->length : size;
+
+	if (stored)
+		memcpy(buffer->data + buffer->length, data, stored);
+	buffer->length += stored;
+	return size;
+}
+
+void
+qr_sink_fixed(qr_sink *sink, qr_buffer *buffer)
+{
+	qr_sink_init(sink, fixed_write, buffer);
+}
+
+static void
+forward(qr_sink *sink, const void *data, size_t size)
+{
+	if (sink->error || !size) return;
+	if (sink->write(sink->context, data, size) != size)
+		sink->error = 1;
+}
+
+int
+qr_sink_flush(qr_sink *sink)
+{
+	forward(sink, sink->buffer, sink->used);
+	sink->used = 0;
+
+	return sink->error ? -1 : 0;
+}
+
+void
+qr_sink_put(qr_sink *sink, const void *data, size_t size)
+{
+	sink->written += size;
+
+	if (size > QR_SINK_BUFFER_SIZE - sink->used)
+	{
+		qr_sink_flush(sink);
+
+		// large writes bypass the buffer
+		if (size >= QR_SINK_BUFFER_SIZE)
+		{
+			forward(sink, data, size);
+			return;
+		}
+	}
+
+	memcpy(sink->buffer + sink->used, data, size);
+	sink->used += size;
+}
+
+void
+qr_sink_puts(qr_sink *sink, const char *string)
+{
+	qr_sink_put(sink, string, strlen(string));
+}
+
+void
+qr_sink_putc(qr_sink *sink, char c)
+{
+	if (sink->used == QR_SINK_BUFFER_SIZE)
+		qr_sink_flush(sink);
+
+	sink->buffer[sink->used++] = c;
+	++sink->written;
+}
+
+void
+qr_sink_put_uint(qr_sink *sink, size_t value)
+{
+	char digits[20];
+	size_t length = 0;
+
+	do
+	{
+		digits[sizeof(digits) - ++length] = '0' + (value % 10);
+		value /= 10;
+	}
+	while (value);
+
+	qr_sink_put(sink, digits + sizeof(digits) - length, length);
+}
+
+void
+qr_buffer_free(qr_buffer *buffer)
+{
+	free(buffer->data);
+	buffer->data = NULL;
+	buffer->length = buffer->capacity = 0;
+}
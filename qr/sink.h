@@ -0,0 +1,42 @@
+#ifndef QR_SINK_H
+#define QR_SINK_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#define QR_SINK_BUFFER_SIZE 4096
+
+typedef size_t (*qr_sink_write)(void *context, const void *data, size_t size);
+
+typedef struct
+{
+	qr_sink_write write;
+	void *context;
+	int error;
+
+	size_t written;
+	size_t used;
+	char buffer[QR_SINK_BUFFER_SIZE];
+} qr_sink;
+
+typedef struct
+{
+	char *data;
+	size_t length;
+	size_t capacity;
+} qr_buffer;
+
+void qr_sink_init(qr_sink *sink, qr_sink_write write, void *context);
+void qr_sink_file(qr_sink *sink, FILE *stream);
+void qr_sink_memory(qr_sink *sink, qr_buffer *buffer);
+void qr_sink_fixed(qr_sink *sink, qr_buffer *buffer);  // never grows the buffer
+
+void qr_sink_put(qr_sink *sink, const void *data, size_t size);
+void qr_sink_puts(qr_sink *sink, const char *string);
+void qr_sink_putc(qr_sink *sink, char c);
+void qr_sink_put_uint(qr_sink *sink, size_t value);
+int qr_sink_flush(qr_sink *sink);
+
+void qr_buffer_free(qr_buffer *buffer);
+
+#endif // QR_SINK_H
@@ -0,0 +1,10 @@
+#ifndef QR_SJIS_H
+#define QR_SJIS_H
+
+#include <stddef.h>
+
+#define QR_SJIS_INVALID ((size_t) -1)
+
+size_t qr_utf8_to_sjis(const char *utf8, size_t size, char *sjis);
+
+#endif // QR_SJIS_H
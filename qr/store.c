@@ -0,0 +1,420 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <qr/batch.h>
+#include <qr/qr.h>
+#include <qr/store.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC "QRSTIDX1"
+#define DATA_MAGIC "QRSTDAT1"
+#define MAGIC_SIZE 8
+#define INDEX_HEADER 32  // magic, slot count, used slots and retired flag
+#define USED_FIELD 16
+#define RETIRED_FIELD 24
+#define SLOT_SIZE 16     // key hash, 0 if free, and record offset
+#define RECORD_HEADER 8  // key length and packed length
+
+// the version, level, mode and mask followed by the modules, eight per byte
+// from the top left row by row; returns the size, packed may be NULL
+size_t
+qr_symbol_pack(const qr_code *qr, unsigned char *packed)
+{
+	size_t i, modules = qr->side_length * qr->side_length;
+
+	if (packed)
+	{
+		packed[0] = qr->version;
+		packed[1] = qr->level;
+		packed[2] = qr->mode;
+		packed[3] = qr->mask;
+
+		memset(packed + QR_STORE_PACKED_HEADER, 0, (modules + 7) / 8);
+		for (i = 0; i < modules; ++i)
+			if (qr->matrix[i])
+				packed[QR_STORE_PACKED_HEADER + i / 8] |= 0x80 >> (i % 8);
+	}
+
+	return QR_STORE_PACKED_HEADER + (modules + 7) / 8;
+}
+
+// fills qr, whose buffers grow as needed, returns -1 for malformed input
+int
+qr_symbol_unpack(const unsigned char *packed, size_t size, qr_code *qr)
+{
+	size_t i, side, modules;
+
+	if (size < QR_STORE_PACKED_HEADER || packed[0] >= QR_VERSION_COUNT || packed[1] > QR_EC_LEVEL_H || packed[2] > QR_MODE_KANJI)
+		return -1;
+
+	side = 21 + 4 * packed[0];
+	modules = side * side;
+	if (size != QR_STORE_PACKED_HEADER + (modules + 7) / 8)
+		return -1;
+
+	qr_reset(qr, packed[1], packed[2], packed[0]);
+	qr->mask = packed[3];
+	for (i = 0; i < modules; ++i)
+		qr->matrix[i] = (packed[QR_STORE_PACKED_HEADER + i / 8] >> (7 - i % 8)) & 1;
+
+	return 0;
+}
+
+static uint64_t
+get_field(const unsigned char *bytes)
+{
+	uint64_t value;
+
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static void
+set_field(unsigned char *bytes, uint64_t value)
+{
+	memcpy(bytes, &value, sizeof(value));
+}
+
+static uint64_t
+key_hash(const void *key, size_t key_length)
+{
+	uint64_t hash = qr_batch_hash(key, key_length);
+
+	return hash ? hash : 1;
+}
+
+static int
+write_all(int fd, const void *data, size_t size)
+{
+	const unsigned char *bytes = data;
+	ssize_t written;
+
+	for (; size; bytes += written, size -= written)
+		if ((written = write(fd, bytes, size)) <= 0)
+			return -1;
+
+	return 0;
+}
+
+// maps the index and checks that the slot count is a power of two that
+// fits the file
+static int
+map_index(qr_store *store)
+{
+	struct stat info;
+	void *mapped;
+
+	if (fstat(store->index_fd, &info) || info.st_size < INDEX_HEADER)
+		return -1;
+	if ((mapped = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, store->index_fd, 0)) == MAP_FAILED)
+		return -1;
+
+	store->index = mapped;
+	store->index_size = info.st_size;
+	store->slot_count = get_field(store->index + MAGIC_SIZE);
+
+	if (!memcmp(store->index, INDEX_MAGIC, MAGIC_SIZE) && store->slot_count && !(store->slot_count & (store->slot_count - 1))
+		&& store->slot_count <= (store->index_size - INDEX_HEADER) / SLOT_SIZE)
+		return 0;
+
+	munmap(store->index, store->index_size);
+	store->index = NULL;
+	return -1;
+}
+
+static void
+unmap_index(qr_store *store)
+{
+	if (store->index) munmap(store->index, store->index_size);
+	if (store->index_fd >= 0) close(store->index_fd);
+
+	store->index = NULL;
+	store->index_fd = -1;
+}
+
+// an index that another process has replaced by a larger one is retired,
+// the larger one is mapped instead
+static int
+current_index(qr_store *store)
+{
+	if (!get_field(store->index + RETIRED_FIELD))
+		return 0;
+
+	unmap_index(store);
+	if ((store->index_fd = open(store->index_path, O_RDWR)) < 0)
+		return -1;
+	return map_index(store);
+}
+
+// writes an index of slot_count slots to the file, the slots of the old
+// index are inserted again if it is given
+static int
+write_index(int fd, uint64_t slot_count, const unsigned char *old, uint64_t old_count)
+{
+	size_t size = INDEX_HEADER + slot_count * SLOT_SIZE;
+	unsigned char *index, *slot;
+	uint64_t i, j, hash, used = 0;
+
+	if (ftruncate(fd, size) || (index = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+		return -1;
+
+	for (i = 0; i < old_count; ++i)
+	{
+		if (!(hash = get_field(old + INDEX_HEADER + i * SLOT_SIZE)))
+			continue;
+
+		for (j = hash; get_field(slot = index + INDEX_HEADER + (j & (slot_count - 1)) * SLOT_SIZE); ++j);
+		memcpy(slot, old + INDEX_HEADER + i * SLOT_SIZE, SLOT_SIZE);
+		++used;
+	}
+
+	memcpy(index, INDEX_MAGIC, MAGIC_SIZE);
+	set_field(index + MAGIC_SIZE, slot_count);
+	set_field(index + USED_FIELD, used);
+
+	munmap(index, size);
+	return 0;
+}
+
+// replaces the index by one of twice the slots, called with the lock held
+// and the data file locked. processes with the old index mapped see that
+// it is retired
+static int
+grow_index(qr_store *store)
+{
+	size_t length = strlen(store->index_path) + sizeof(".new");
+	char *path = malloc(length);
+	int fd, status = -1;
+
+	snprintf(path, length, "%s.new", store->index_path);
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666)) >= 0)
+	{
+		if (!write_index(fd, 2 * store->slot_count, store->index, store->slot_count) && !rename(path, store->index_path))
+		{
+			set_field(store->index + RETIRED_FIELD, 1);
+			unmap_index(store);
+			store->index_fd = fd;
+			status = map_index(store);
+		}
+		else
+		{
+			close(fd);
+			unlink(path);
+		}
+	}
+
+	free(path);
+	return status;
+}
+
+// maps the data file again once it has grown past the mapping
+static int
+map_data(qr_store *store, size_t needed)
+{
+	struct stat info;
+	void *mapped;
+
+	if (needed <= store->data_size)
+		return 0;
+	if (fstat(store->data_fd, &info) || (size_t) info.st_size < needed)
+		return -1;
+	if ((mapped = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, store->data_fd, 0)) == MAP_FAILED)
+		return -1;
+
+	if (store->data) munmap((void *) store->data, store->data_size);
+	store->data = mapped;
+	store->data_size = info.st_size;
+	return 0;
+}
+
+// new stores start with slot_count slots
+static int
+open_store(qr_store *store, const char *directory, uint64_t slot_count)
+{
+	size_t length = strlen(directory) + sizeof("/symbols");
+	char *path = malloc(length);
+	struct stat info;
+	int status = -1;
+
+	store->index = NULL;
+	store->data = NULL;
+	store->data_size = 0;
+	store->hits = store->misses = 0;
+	store->index_path = malloc(length);
+	pthread_mutex_init(&store->lock, NULL);
+	snprintf(store->index_path, length, "%s/index", directory);
+
+	if (mkdir(directory, 0777) && errno != EEXIST)
+	{
+		store->index_fd = store->data_fd = -1;
+		free(path);
+		qr_store_close(store);
+		return -1;
+	}
+
+	store->index_fd = open(store->index_path, O_RDWR | O_CREAT, 0666);
+	snprintf(path, length, "%s/symbols", directory);
+	store->data_fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0666);
+	free(path);
+
+	// the first process creates both files
+	if (store->index_fd >= 0 && store->data_fd >= 0 && !flock(store->data_fd, LOCK_EX))
+	{
+		if (!fstat(store->index_fd, &info) && (info.st_size || (!write_index(store->index_fd, slot_count, NULL, 0) && !write_all(store->data_fd, DATA_MAGIC, MAGIC_SIZE))))
+			status = map_index(store);
+		flock(store->data_fd, LOCK_UN);
+	}
+
+	if (!status && (map_data(store, MAGIC_SIZE) || memcmp(store->data, DATA_MAGIC, MAGIC_SIZE)))
+		status = -1;
+
+	if (status)
+		qr_store_close(store);
+
+	return status;
+}
+
+int
+qr_store_open(qr_store *store, const char *directory)
+{
+	return open_store(store, directory, QR_STORE_SLOTS);
+}
+
+// returns the slot of key or the free slot to put it in, NULL if neither is
+// found; called with the lock held
+static unsigned char *
+find_slot(qr_store *store, uint64_t hash, const void *key, size_t key_length)
+{
+	unsigned char *slot;
+	uint64_t i, offset, probes, slot_hash;
+	uint32_t stored_length;
+
+	for (i = hash, probes = 0; probes < store->slot_count; ++i, ++probes)
+	{
+		slot = store->index + INDEX_HEADER + (i & (store->slot_count - 1)) * SLOT_SIZE;
+		if (!(slot_hash = get_field(slot)))
+			return slot;
+		if (slot_hash != hash)
+			continue;
+
+		// records written by other processes may lie past the mapping, and
+		// records are not aligned
+		offset = get_field(slot + 8);
+		if (offset > SIZE_MAX - RECORD_HEADER || map_data(store, offset + RECORD_HEADER))
+			continue;
+		memcpy(&stored_length, store->data + offset, sizeof(stored_length));
+		if (stored_length != key_length || map_data(store, offset + RECORD_HEADER + key_length))
+			continue;
+		if (!memcmp(store->data + offset + RECORD_HEADER, key, key_length))
+			return slot;
+	}
+
+	return NULL;
+}
+
+// unpacks the stored symbol of key into qr and returns 1 if it is stored. a
+// miss checks whether another process has replaced the index
+static int
+get_symbol(qr_store *store, const void *key, size_t key_length, qr_code *qr)
+{
+	unsigned char *slot = find_slot(store, key_hash(key, key_length), key, key_length);
+	uint64_t offset;
+	uint32_t size;
+
+	if (!slot || !get_field(slot))
+		return 0;
+
+	offset = get_field(slot + 8);
+	memcpy(&size, store->data + offset + 4, sizeof(size));
+	return !map_data(store, offset + RECORD_HEADER + key_length + size)
+		&& !qr_symbol_unpack(store->data + offset + RECORD_HEADER + key_length, size, qr);
+}
+
+int
+qr_store_get(qr_store *store, const void *key, size_t key_length, qr_code *qr)
+{
+	int found;
+
+	pthread_mutex_lock(&store->lock);
+	found = store->index && get_symbol(store, key, key_length, qr);
+	if (!found && store->index && get_field(store->index + RETIRED_FIELD) && !current_index(store))
+		found = get_symbol(store, key, key_length, qr);
+
+	if (found) ++store->hits;
+	else ++store->misses;
+	pthread_mutex_unlock(&store->lock);
+
+	return found;
+}
+
+// appends the symbol of key unless it is stored already, the index is
+// doubled once 3/4 of it is used. returns -1 if the files could not be
+// written
+int
+qr_store_put(qr_store *store, const void *key, size_t key_length, const qr_code *qr)
+{
+	uint32_t header[2] = { key_length, qr_symbol_pack(qr, NULL) };
+	uint64_t hash = key_hash(key, key_length), used;
+	unsigned char *packed = malloc(header[1]), *slot = NULL;
+	off_t offset;
+	int status = -1;
+
+	qr_symbol_pack(qr, packed);
+
+	pthread_mutex_lock(&store->lock);
+	flock(store->data_fd, LOCK_EX);
+
+	if (store->index && !current_index(store))
+	{
+		used = get_field(store->index + USED_FIELD);
+		if (used < store->slot_count / 4 * 3 || !grow_index(store))
+			slot = find_slot(store, hash, key, key_length);
+	}
+
+	if (slot && get_field(slot))
+	{
+		status = 0;
+	}
+	else if (slot && (offset = lseek(store->data_fd, 0, SEEK_END)) >= 0
+		&& !write_all(store->data_fd, header, sizeof(header))
+		&& !write_all(store->data_fd, key, key_length)
+		&& !write_all(store->data_fd, packed, header[1]))
+	{
+		// the hash goes last, so that no reader finds a slot without offset
+		set_field(slot + 8, offset);
+		set_field(slot, hash);
+		set_field(store->index + USED_FIELD, get_field(store->index + USED_FIELD) + 1);
+		status = 0;
+	}
+
+	flock(store->data_fd, LOCK_UN);
+	pthread_mutex_unlock(&store->lock);
+	free(packed);
+
+	return status;
+}
+
+void
+qr_store_close(qr_store *store)
+{
+	if (store->index) munmap(store->index, store->index_size);
+	if (store->data) munmap((void *) store->data, store->data_size);
+	if (store->index_fd >= 0) close(store->index_fd);
+	if (store->data_fd >= 0) close(store->data_fd);
+
+	pthread_mutex_destroy(&store->lock);
+	free(store->index_path);
+
+	store->index = NULL;
+	store->data = NULL;
+	store->index_path = NULL;
+}
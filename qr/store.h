@@ -0,0 +1,42 @@
+#ifndef QR_STORE_H
+#define QR_STORE_H
+
+#include <pthread.h>
+#include <qr/types.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define QR_STORE_SLOTS (1 << 20)  // of a new index, doubled once 3/4 are used
+#define QR_STORE_PACKED_HEADER 4  // version, level, mode and mask
+
+// an on-disk cache of symbols in a directory: an append-only file of
+// records of the key and the packed symbol, and a hash index of slots of
+// the key hash and the record offset. both are mapped, the index for
+// writing, and replaced by one of twice the slots once it is 3/4 full.
+// files are in host byte order and only shared between processes
+// on one host, which take turns writing by locking the data file
+typedef struct
+{
+	int index_fd, data_fd;
+	char *index_path;  // reopened once another process replaces the index
+
+	unsigned char *index;
+	size_t index_size;
+	uint64_t slot_count;
+
+	const unsigned char *data;  // mapped bytes of the data file
+	size_t data_size;
+
+	pthread_mutex_t lock;
+	size_t hits, misses;
+} qr_store;
+
+size_t qr_symbol_pack(const qr_code *qr, unsigned char *packed);
+int qr_symbol_unpack(const unsigned char *packed, size_t size, qr_code *qr);
+
+int qr_store_open(qr_store *store, const char *directory);
+int qr_store_get(qr_store *store, const void *key, size_t key_length, qr_code *qr);
+int qr_store_put(qr_store *store, const void *key, size_t key_length, const qr_code *qr);
+void qr_store_close(qr_store *store);
+
+#endif // QR_STORE_H
@@ -0,0 +1,44 @@
+#include <qr/matrix.h>
+#include <qr/sink.h>
+#include <qr/text.h>
+#include <qr/types.h>
+#include <stddef.h>
+
+// indexed by top | bottom << 1, a set bit is a light module
+static const char *HALF_BLOCKS[4] = { " ", "▀", "▄", "█" };
+
+static int
+module_is_light(const qr_code *qr, size_t quiet_zone, size_t i, size_t j)
+{
+	if (i < quiet_zone || j < quiet_zone) return 1;
+	i -= quiet_zone;
+	j -= quiet_zone;
+	if (i >= qr->side_length || j >= qr->side_length) return 1;
+
+	return !qr_module_get(qr, i, j);
+}
+
+// two module rows per line, light modules are drawn with the glyph and dark
+// modules are left to the background, which is assumed to be dark unless
+// ansi sets the colors once per line
+void
+qr_text_render(const qr_code *qr, size_t quiet_zone, int ansi, qr_sink *sink)
+{
+	size_t modules = qr->side_length + 2 * quiet_zone, i, j;
+	int top, bottom;
+
+	for (i = 0; i < modules; i += 2)
+	{
+		if (ansi) qr_sink_puts(sink, "\x1b[97;40m");
+
+		for (j = 0; j < modules; ++j)
+		{
+			top = module_is_light(qr, quiet_zone, i, j);
+			bottom = i + 1 < modules && module_is_light(qr, quiet_zone, i + 1, j);
+			qr_sink_puts(sink, HALF_BLOCKS[top | bottom << 1]);
+		}
+
+		if (ansi) qr_sink_puts(sink, "\x1b[0m");
+		qr_sink_putc(sink, '\n');
+	}
+}
@@ -0,0 +1,10 @@
+#ifndef QR_TEXT_H
+#define QR_TEXT_H
+
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stddef.h>
+
+void qr_text_render(const qr_code *qr, size_t quiet_zone, int ansi, qr_sink *sink);
+
+#endif // QR_TEXT_H
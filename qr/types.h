@@ -17,16 +17,44 @@ typedef enum
 
 typedef enum
 {
+	QR_MODE_NUMERIC,
+	QR_MODE_ALPHANUMERIC,
 	QR_MODE_BYTE,
+	QR_MODE_KANJI,
+	QR_MODE_ECI,
+	QR_MODE_STRUCTURED_APPEND,
+	QR_MODE_COUNT
 } qr_encoding_mode;
 
+#define QR_ECI_UTF8 26
+#define QR_ECI_MAX 999999
+
 typedef uint8_t word;
 
+typedef struct
+{
+	qr_encoding_mode mode;
+	const char *data;
+	size_t length;
+
+	union
+	{
+		unsigned eci;
+		struct
+		{
+			unsigned index;
+			unsigned total;
+			word parity;
+		} append;
+	};
+} qr_segment;
+
 typedef struct
 {
 	qr_ec_level level;
 	qr_encoding_mode mode;
 	unsigned version;
+	unsigned capacity;  // largest version the buffers fit
 
 	int *matrix;
 	size_t side_length;
@@ -35,6 +63,8 @@ typedef struct
 
 	size_t codeword_count;
 	word *codewords;
+
+	struct qr_pool *ec_pool;  // computes the ec blocks, NULL for the calling thread
 } qr_code;
 
 #endif // QR_TYPES_H
@@ -0,0 +1,86 @@
+/**
+ * @file append.c
+ * @brief Test cases for structured append
+ *
+ * This file contains test cases for splitting a message across multiple
+ * symbols, including the parity byte, the symbol sequence headers and the
+ * chunk boundaries.
+ */
+
+#include <test/base.h>
+#include <qr/types.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/append.c"
+
+/**
+ * @brief Test the structured append parity
+ *
+ * The parity is the XOR of all bytes of the complete message.
+ */
+TEST(parity)
+{
+	test_expect_eq(qr_append_parity("", 0), 0x00, "Parity of empty message");
+	test_expect_eq(qr_append_parity("\x01\x02\x04", 3), 0x07, "Parity of distinct bits");
+	test_expect_eq(qr_append_parity("\xFF\x0F\xFF", 3), 0x0F, "Parity of repeated bytes");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test splitting a message across symbols
+ *
+ * Verifies that every symbol starts with a sequence header carrying its
+ * position, the symbol count and the parity, that the chunks cover the
+ * message in order and that no symbol exceeds the requested version.
+ */
+TEST(plan_symbols)
+{
+	symbol_job jobs[QR_APPEND_MAX_SYMBOLS];
+	char message[200];
+	size_t i, j, covered = 0;
+
+	for (i = 0; i < sizeof(message); ++i)
+		message[i] = 'a' + (i % 26);
+
+	test_expect_ne(plan_symbols(message, sizeof(message), 0, QR_EC_LEVEL_L, 1, NULL, 0, 1, jobs), 0, "Message does not fit one version 2 symbol");
+	test_expect_eq(plan_symbols(message, sizeof(message), 0, QR_EC_LEVEL_L, 1, NULL, 0, 8, jobs), 0, "Message fits eight version 2 symbols");
+
+	for (i = 0; i < 8; ++i)
+	{
+		test_expect_le(jobs[i].version, 1, "Symbol version does not exceed the maximum");
+		test_expect_eq(jobs[i].segments[0].mode, QR_MODE_STRUCTURED_APPEND, "Symbol starts with structured append header");
+		test_expect_eq(jobs[i].segments[0].append.index, i, "Symbol position");
+		test_expect_eq(jobs[i].segments[0].append.total, 8, "Symbol count");
+		test_expect_eq(jobs[i].segments[0].append.parity, qr_append_parity(message, sizeof(message)), "Symbol parity");
+
+		for (j = 1; j < jobs[i].count; ++j)
+		{
+			test_expect_eq(jobs[i].segments[j].data == message + covered, 1, "Chunks are contiguous");
+			covered += jobs[i].segments[j].length;
+		}
+		free(jobs[i].segments);
+	}
+	test_expect_eq(covered, sizeof(message), "Chunks cover the complete message");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that chunk boundaries respect double-byte characters
+ *
+ * A chunk boundary must never fall between the two bytes of a Shift-JIS
+ * character.
+ */
+TEST(kanji_chunk_boundary)
+{
+	// the midpoint of five double-byte characters lies inside the third one
+	const char *message = "\x88\x9F\x88\x9F\x88\x9F\x88\x9F\x88\x9F";
+
+	test_expect_eq(chunk_end(message, 10, 1, 0, 5), 6, "Boundary is moved past the double-byte character");
+	test_expect_eq(chunk_end(message, 10, 0, 0, 5), 5, "Boundary is kept without kanji");
+
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file batch.c
+ * @brief Test cases for batch input and output
+ *
+ * This file contains test cases for reading delimited records, assigning
+ * them to shards, naming the output file of each record and writing
+ * length-prefixed records.
+ */
+
+#include <test/base.h>
+#include <qr/batch.h>
+#include <qr/sink.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/batch.c"
+
+/**
+ * @brief Test reading newline and NUL delimited records
+ *
+ * The last record needs no delimiter and empty records are kept.
+ */
+TEST(reader_records)
+{
+	static char lines[] = "first\n\nthird";
+	static char strings[] = "a\nb\0c\0";
+	qr_batch_reader reader;
+	const char *record;
+	size_t length;
+	FILE *stream;
+
+	stream = fmemopen(lines, strlen(lines), "r");
+	qr_batch_reader_init(&reader, stream, '\n');
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(strcmp(record, "first"), 0, "First line without newline");
+	test_expect_eq(length, 5, "First line length");
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(length, 0, "Empty line is a record");
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(strcmp(record, "third"), 0, "Last line needs no newline");
+	test_expect_eq(reader.index, 3, "Three records");
+	test_expect_eq(qr_batch_next(&reader, &length) == NULL, 1, "End of input");
+	qr_batch_reader_free(&reader);
+	fclose(stream);
+
+	stream = fmemopen(strings, sizeof(strings) - 1, "r");
+	qr_batch_reader_init(&reader, stream, '\0');
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(strcmp(record, "a\nb"), 0, "Newline inside a NUL delimited record");
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(strcmp(record, "c"), 0, "Second NUL delimited record");
+	test_expect_eq(qr_batch_next(&reader, &length) == NULL, 1, "End of input");
+	qr_batch_reader_free(&reader);
+	fclose(stream);
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that CRLF line ends give the same records as LF
+ *
+ * A carriage return is only removed in front of a newline delimiter.
+ */
+TEST(reader_crlf)
+{
+	static char lines[] = "first\r\n\r\nmid\rdle\r\nlast\r";
+	static char strings[] = "a\r\0";
+	qr_batch_reader reader;
+	const char *record;
+	size_t length;
+	FILE *stream;
+
+	stream = fmemopen(lines, strlen(lines), "r");
+	qr_batch_reader_init(&reader, stream, '\n');
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(length == 5 && !strcmp(record, "first"), 1, "Carriage return before newline is removed");
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(length, 0, "Empty CRLF line is an empty record");
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(strcmp(record, "mid\rdle"), 0, "Carriage return inside a line is kept");
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(strcmp(record, "last\r"), 0, "Carriage return without newline is kept");
+	qr_batch_reader_free(&reader);
+	fclose(stream);
+
+	stream = fmemopen(strings, sizeof(strings) - 1, "r");
+	qr_batch_reader_init(&reader, stream, '\0');
+	record = qr_batch_next(&reader, &length);
+	test_expect_eq(length, 2, "Carriage return is kept in NUL delimited records");
+	qr_batch_reader_free(&reader);
+	fclose(stream);
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the validation and expansion of output patterns
+ */
+TEST(output_paths)
+{
+	char path[16];
+
+	test_expect_eq(qr_batch_pattern_is_valid("out/qr-%n.png"), 1, "Pattern with a number");
+	test_expect_eq(qr_batch_pattern_is_valid("out/qr.png"), 0, "Pattern without a number");
+	test_expect_eq(qr_batch_pattern_is_valid("100%%n.png"), 0, "Escaped percent sign");
+	test_expect_eq(qr_batch_pattern_is_valid("%d-%n.png"), 0, "Unknown conversion");
+
+	test_expect_eq(qr_batch_path("qr-%n.png", 42, path, sizeof(path)), 9, "Expanded length");
+	test_expect_eq(strcmp(path, "qr-42.png"), 0, "Expanded path");
+	test_expect_eq(qr_batch_path("%%%n", 7, path, sizeof(path)), 2, "Escaped length");
+	test_expect_eq(strcmp(path, "%7"), 0, "Escaped path");
+	test_expect_eq(qr_batch_path("long-name-%n.png", 12345, path, sizeof(path)), 19, "Length of a truncated path");
+	test_expect_eq(strcmp(path, "long-name-12345"), 0, "Truncated path");
+	test_expect_eq(qr_batch_path("qr-%n.png", 1, NULL, 0), 8, "Size query");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the assignment of records to shards
+ *
+ * Shards by number take turns, shards by hash depend on the payload only.
+ */
+TEST(shards)
+{
+	unsigned counts[4] = { 0 };
+	char payload[16];
+	size_t i;
+
+	test_expect_eq(qr_batch_hash("a", 1) == 0xAF63DC4C8601EC8C, 1, "FNV-1a of one byte");
+	test_expect_eq(qr_batch_hash("", 0) == 0xCBF29CE484222325, 1, "FNV-1a offset basis");
+
+	test_expect_eq(qr_batch_shard(1, NULL, 0, 3, 0), 1, "First record in the first shard");
+	test_expect_eq(qr_batch_shard(3, NULL, 0, 3, 0), 3, "Third record in the last shard");
+	test_expect_eq(qr_batch_shard(4, NULL, 0, 3, 0), 1, "Fourth record starts over");
+	test_expect_eq(qr_batch_shard(7, NULL, 0, 1, 0), 1, "A single shard gets every record");
+
+	test_expect_eq(qr_batch_shard(1, "url", 3, 4, 1), qr_batch_shard(99, "url", 3, 4, 1), "Equal payloads share a shard");
+	for (i = 0; i < 400; ++i)
+	{
+		snprintf(payload, sizeof(payload), "item-%zu", i);
+		++counts[qr_batch_shard(i + 1, payload, strlen(payload), 4, 1) - 1];
+	}
+	for (i = 0; i < 4; ++i)
+		test_expect_gt(counts[i], 50, "Hashes spread over all shards");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the length prefix of output records
+ */
+TEST(put_record)
+{
+	static const uint8_t expected[] = { 0, 0, 0, 3, 'a', 'b', 'c', 0, 0, 0, 0, 0, 0, 0, 9, 0, 0, 0, 1, 'z' };
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+
+	qr_sink_memory(&sink, &buffer);
+	qr_batch_put_record(&sink, "abc", 3);
+	qr_batch_put_record(&sink, NULL, 0);
+	qr_batch_put_numbered_record(&sink, 9, "z", 1);
+	qr_sink_flush(&sink);
+	test_expect_eq(buffer.length, sizeof(expected), "Record lengths");
+	test_expect_eq(memcmp(buffer.data, expected, sizeof(expected)), 0, "Records");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
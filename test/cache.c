@@ -0,0 +1,177 @@
+/**
+ * @file cache.c
+ * @brief Test cases for the least recently used output cache
+ *
+ * This file contains test cases for lookups, the byte budget, the eviction
+ * order and the hit and miss counters.
+ */
+
+#include <test/base.h>
+#include <qr/cache.h>
+#include <qr/sink.h>
+#include <stdio.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/cache.c"
+
+/**
+ * @brief Looks up key and compares its value with expected, NULL for a miss
+ */
+static int
+has_value(qr_cache *cache, const char *key, const char *expected)
+{
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+	int found, equal;
+
+	qr_sink_memory(&sink, &buffer);
+	found = qr_cache_get(cache, key, strlen(key), &sink);
+	qr_sink_flush(&sink);
+
+	equal = expected ? found && buffer.length == strlen(expected) && !memcmp(buffer.data, expected, buffer.length) : !found;
+	qr_buffer_free(&buffer);
+	return equal;
+}
+
+/**
+ * @brief Test lookups, replacement and the counters
+ */
+TEST(get_put)
+{
+	qr_cache cache;
+
+	qr_cache_init(&cache, 4096);
+	test_expect_eq(has_value(&cache, "a", NULL), 1, "Empty cache misses");
+
+	qr_cache_put(&cache, "a", 1, "first", 5);
+	qr_cache_put(&cache, "ab", 2, "second", 6);
+	test_expect_eq(has_value(&cache, "a", "first"), 1, "Value of a short key");
+	test_expect_eq(has_value(&cache, "ab", "second"), 1, "Value of a longer key");
+	test_expect_eq(has_value(&cache, "b", NULL), 1, "Unknown key misses");
+
+	qr_cache_put(&cache, "a", 1, "replaced", 8);
+	test_expect_eq(has_value(&cache, "a", "replaced"), 1, "Value is replaced");
+	test_expect_eq(cache.count, 2, "Replacing keeps one entry per key");
+	test_expect_eq(cache.used, 2 * sizeof(qr_cache_entry) + 1 + 8 + 2 + 6, "Bytes of keys, values and entries");
+
+	test_expect_eq(cache.hits, 3, "Hits are counted");
+	test_expect_eq(cache.misses, 2, "Misses are counted");
+
+	qr_cache_free(&cache);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that the least recently used entries are evicted first
+ */
+TEST(eviction)
+{
+	const size_t entry = sizeof(qr_cache_entry) + 1 + 10;
+	qr_cache cache;
+
+	qr_cache_init(&cache, 3 * entry);
+	qr_cache_put(&cache, "a", 1, "0123456789", 10);
+	qr_cache_put(&cache, "b", 1, "0123456789", 10);
+	qr_cache_put(&cache, "c", 1, "0123456789", 10);
+	test_expect_eq(has_value(&cache, "a", "0123456789"), 1, "Reading a makes b the oldest");
+
+	qr_cache_put(&cache, "d", 1, "0123456789", 10);
+	test_expect_eq(has_value(&cache, "b", NULL), 1, "Oldest entry is evicted");
+	test_expect_eq(has_value(&cache, "a", "0123456789"), 1, "Recently read entry is kept");
+	test_expect_eq(has_value(&cache, "d", "0123456789"), 1, "New entry is kept");
+	test_expect_eq(cache.evictions, 1, "Evictions are counted");
+	test_expect_le(cache.used, cache.budget, "Budget is kept");
+
+	qr_cache_put(&cache, "e", 1, "too large for the whole budget", 30 + 3 * entry);
+	test_expect_eq(has_value(&cache, "e", NULL), 1, "Oversized value is not stored");
+	test_expect_eq(cache.count, 3, "Oversized value evicts nothing");
+
+	qr_cache_free(&cache);
+	return TEST_SUCCESS;
+}
+
+typedef struct
+{
+	qr_cache *cache;
+	qr_buffer written;
+} evicting_context;
+
+/**
+ * @brief Sink write function that fills the cache with another entry first
+ */
+static size_t
+write_evicting(void *context, const void *data, size_t size)
+{
+	evicting_context *evicting = context;
+	static char other[6000];
+	qr_sink sink;
+
+	qr_cache_put(evicting->cache, "other", 5, other, sizeof(other));
+
+	qr_sink_memory(&sink, &evicting->written);
+	qr_sink_put(&sink, data, size);
+	qr_sink_flush(&sink);
+	return size;
+}
+
+/**
+ * @brief Test that an entry evicted while its value is written stays valid
+ *
+ * The sink evicts the entry being read, which also requires the lock to be
+ * released while the value is written.
+ */
+TEST(evicted_while_read)
+{
+	evicting_context evicting = { 0 };
+	char value[6000];
+	qr_cache cache;
+	qr_sink sink;
+
+	memset(value, 'v', sizeof(value));
+	qr_cache_init(&cache, sizeof(qr_cache_entry) + 5 + sizeof(value) + 100);
+	qr_cache_put(&cache, "value", 5, value, sizeof(value));
+
+	evicting.cache = &cache;
+	qr_sink_init(&sink, write_evicting, &evicting);
+	test_expect_eq(qr_cache_get(&cache, "value", 5, &sink), 1, "Value is found");
+	qr_sink_flush(&sink);
+
+	test_expect_eq(evicting.written.length, sizeof(value), "Whole value is written");
+	test_expect_eq(memcmp(evicting.written.data, value, sizeof(value)), 0, "Value is unchanged after its eviction");
+	test_expect_eq(cache.evictions, 1, "Value was evicted while it was written");
+	test_expect_eq(has_value(&cache, "value", NULL), 1, "Evicted value is gone");
+
+	qr_buffer_free(&evicting.written);
+	qr_cache_free(&cache);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that all entries stay reachable while the buckets grow
+ */
+TEST(many_entries)
+{
+	char key[16], value[16];
+	qr_cache cache;
+	size_t i;
+
+	qr_cache_init(&cache, 1 << 20);
+	for (i = 0; i < 1000; ++i)
+	{
+		snprintf(key, sizeof(key), "key-%zu", i);
+		snprintf(value, sizeof(value), "value-%zu", i);
+		qr_cache_put(&cache, key, strlen(key), value, strlen(value));
+	}
+	test_expect_ge(cache.bucket_count, 1000, "Buckets grow with the entries");
+
+	for (i = 0; i < 1000; ++i)
+	{
+		snprintf(key, sizeof(key), "key-%zu", i);
+		snprintf(value, sizeof(value), "value-%zu", i);
+		test_expect_eq(has_value(&cache, key, value), 1, "Every entry is found");
+	}
+
+	qr_cache_free(&cache);
+	return TEST_SUCCESS;
+}
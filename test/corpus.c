@@ -0,0 +1,142 @@
+/**
+ * @file corpus.c
+ * @brief Test cases for mapped corpora of length-prefixed records
+ *
+ * This file contains test cases for finding records by a scan or an index,
+ * writing the index and rejecting records outside of the file.
+ */
+
+#include <test/base.h>
+#include <qr/corpus.h>
+#include <qr/sink.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Include the source file directly to test static functions
+#include "../qr/corpus.c"
+
+/**
+ * @brief Writes data to a new temporary file and returns its path
+ */
+static char *
+write_temporary(const void *data, size_t size)
+{
+	char *path = test_malloc(32);
+	FILE *file;
+	int fd;
+
+	strcpy(path, "/tmp/qr-corpus-XXXXXX");
+	if ((fd = mkstemp(path)) < 0) return NULL;
+
+	file = fdopen(fd, "wb");
+	fwrite(data, 1, size, file);
+	fclose(file);
+	return path;
+}
+
+/**
+ * @brief Test scanning records, including empty ones and NUL bytes
+ */
+TEST(scan_records)
+{
+	static const char data[] = "\0\0\0\3abc\0\0\0\0\0\0\0\3x\0y";
+	char *path = write_temporary(data, sizeof(data) - 1);
+	const char *record;
+	qr_corpus corpus;
+	size_t length;
+
+	if (!path) return TEST_FAILURE("Failed to create corpus file");
+	test_expect_eq(qr_corpus_open(&corpus, path), 0, "Corpus is mapped");
+	test_expect_eq(qr_corpus_scan(&corpus), 0, "Scan finds every record");
+	test_expect_eq(corpus.count, 3, "Three records");
+
+	record = qr_corpus_record(&corpus, 0, &length);
+	test_expect_eq(length, 3, "First record length");
+	test_expect_eq(memcmp(record, "abc", 3), 0, "First record payload");
+	record = qr_corpus_record(&corpus, 1, &length);
+	test_expect_eq(length, 0, "Empty record");
+	record = qr_corpus_record(&corpus, 2, &length);
+	test_expect_eq(length, 3, "Record with a NUL byte");
+	test_expect_eq(memcmp(record, "x\0y", 3), 0, "Payload with a NUL byte");
+	test_expect_eq(qr_corpus_record(&corpus, 3, &length) == NULL, 1, "No record after the last");
+
+	qr_corpus_close(&corpus);
+	unlink(path);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a cut off record fails the scan
+ */
+TEST(scan_cut_off)
+{
+	static const char data[] = "\0\0\0\1a\0\0\0\5abc";
+	char *path = write_temporary(data, sizeof(data) - 1);
+	qr_corpus corpus;
+
+	if (!path) return TEST_FAILURE("Failed to create corpus file");
+	test_expect_eq(qr_corpus_open(&corpus, path), 0, "Corpus is mapped");
+	test_expect_eq(qr_corpus_scan(&corpus), -1, "Payload shorter than its length");
+
+	qr_corpus_close(&corpus);
+	unlink(path);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test writing an index and reading records through it
+ */
+TEST(index_records)
+{
+	static const char data[] = "\0\0\0\2ab\0\0\0\1c";
+	static const unsigned char expected[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6 };
+	static const unsigned char outside[] = { 0, 0, 0, 0, 0, 0, 0, 8 };
+	char *path = write_temporary(data, sizeof(data) - 1), *index_path;
+	qr_buffer buffer = { 0 };
+	const char *record;
+	qr_corpus corpus;
+	qr_sink sink;
+	size_t length;
+
+	if (!path) return TEST_FAILURE("Failed to create corpus file");
+	qr_corpus_open(&corpus, path);
+	qr_corpus_scan(&corpus);
+	qr_sink_memory(&sink, &buffer);
+	qr_corpus_put_index(&corpus, &sink);
+	qr_sink_flush(&sink);
+	qr_corpus_close(&corpus);
+	test_expect_eq(buffer.length, sizeof(expected), "One entry per record");
+	test_expect_eq(memcmp(buffer.data, expected, sizeof(expected)), 0, "Big endian offsets");
+
+	index_path = write_temporary(buffer.data, buffer.length);
+	if (!index_path) return TEST_FAILURE("Failed to create index file");
+	qr_corpus_open(&corpus, path);
+	test_expect_eq(qr_corpus_open_index(&corpus, index_path), 0, "Index is mapped");
+	test_expect_eq(corpus.count, 2, "Count from the index");
+	record = qr_corpus_record(&corpus, 1, &length);
+	test_expect_eq(length, 1, "Second record length");
+	test_expect_eq(*record, 'c', "Second record payload");
+	qr_corpus_close(&corpus);
+	unlink(index_path);
+
+	index_path = write_temporary(outside, sizeof(outside));
+	if (!index_path) return TEST_FAILURE("Failed to create index file");
+	qr_corpus_open(&corpus, path);
+	qr_corpus_open_index(&corpus, index_path);
+	test_expect_eq(qr_corpus_record(&corpus, 0, &length) == NULL, 1, "Length header outside of the file");
+	qr_corpus_close(&corpus);
+	unlink(index_path);
+
+	index_path = write_temporary(outside, 5);
+	if (!index_path) return TEST_FAILURE("Failed to create index file");
+	qr_corpus_open(&corpus, path);
+	test_expect_eq(qr_corpus_open_index(&corpus, index_path), -1, "Partial index entry");
+	qr_corpus_close(&corpus);
+	unlink(index_path);
+
+	qr_buffer_free(&buffer);
+	unlink(path);
+	return TEST_SUCCESS;
+}
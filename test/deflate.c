@@ -0,0 +1,173 @@
+/**
+ * @file deflate.c
+ * @brief Test cases for the deflate compressor and its checksums
+ *
+ * This file contains test cases for CRC-32, Adler-32, the fixed Huffman
+ * deflate stream used by the PNG writer and the dynamic Huffman codes of
+ * the gzip output.
+ */
+
+#include <test/base.h>
+#include <qr/sink.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/deflate.c"
+
+/**
+ * @brief Test the checksums against their published check values
+ */
+TEST(checksums)
+{
+	test_expect_eq(qr_crc32(0, "123456789", 9), (int) 0xCBF43926, "CRC-32 check value");
+	test_expect_eq(qr_crc32(qr_crc32(0, "1234", 4), "56789", 5), (int) 0xCBF43926, "CRC-32 continued across calls");
+	test_expect_eq(qr_crc32(0, "", 0), 0, "CRC-32 of nothing");
+
+	test_expect_eq(qr_adler32(1, "Wikipedia", 9), 0x11E60398, "Adler-32 check value");
+	test_expect_eq(qr_adler32(1, "", 0), 1, "Adler-32 of nothing");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the length and distance codes of the fixed Huffman block
+ *
+ * Ten repeated bytes are one literal followed by a match of length 9 at
+ * distance 1, wrapped in a zlib header and Adler-32 trailer.
+ */
+TEST(zlib_stream)
+{
+	static const uint8_t expected[] =
+	{
+		0x78, 0x01, 0x4A, 0x84, 0x03, 0xC0, 0x00, 0x14, 0xE1, 0x03, 0xCB,
+	};
+	static const uint8_t empty[] = { 0x02, 0x0C, 0x00 };
+	static qr_deflate deflate;
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+
+	qr_sink_memory(&sink, &buffer);
+	qr_deflate_init(&deflate, QR_DEFLATE_ZLIB, QR_DEFLATE_FAST, &sink);
+	qr_deflate_write(&deflate, "aaaaa", 5);
+	qr_deflate_write(&deflate, "aaaaa", 5);
+	qr_deflate_finish(&deflate);
+	test_expect_eq(qr_sink_flush(&sink), 0, "Flush succeeds");
+
+	test_expect_eq(buffer.length, sizeof(expected), "Stream length");
+	test_expect_eq(memcmp(buffer.data, expected, sizeof(expected)), 0, "Stream bytes");
+
+	buffer.length = 0;
+	qr_deflate_init(&deflate, QR_DEFLATE_RAW, QR_DEFLATE_FAST, &sink);
+	qr_deflate_finish(&deflate);
+	qr_sink_flush(&sink);
+
+	test_expect_eq(buffer.length, sizeof(empty), "Empty raw stream length");
+	test_expect_eq(memcmp(buffer.data, empty, sizeof(empty)), 0, "Empty raw stream bytes");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test input spanning several window slides
+ *
+ * A repeating row pattern longer than the window must still be found by
+ * the matcher after the window has moved and the hash chains were rebased.
+ */
+TEST(window_slide)
+{
+	static qr_deflate deflate;
+	static uint8_t input[5 * QR_DEFLATE_WINDOW_SIZE];
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+	size_t i;
+
+	for (i = 0; i < sizeof(input); ++i)
+		input[i] = (i % 301) < 150 ? 0x00 : 0xFF;
+
+	qr_sink_memory(&sink, &buffer);
+	qr_deflate_init(&deflate, QR_DEFLATE_ZLIB, QR_DEFLATE_FAST, &sink);
+	for (i = 0; i < sizeof(input); i += 1000)
+		qr_deflate_write(&deflate, input + i, sizeof(input) - i < 1000 ? sizeof(input) - i : 1000);
+	qr_deflate_finish(&deflate);
+	qr_sink_flush(&sink);
+
+	test_expect_lt(buffer.length, sizeof(input) / 20, "Repeated rows compress to under 5%");
+	test_expect_le(deflate.position, sizeof(deflate.window), "Position stays within the window");
+	test_expect_eq((uint8_t) buffer.data[buffer.length - 1], qr_adler32(1, input, sizeof(input)) & 0xFF, "Trailer holds the checksum");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the gzip container around a stream written through a sink
+ *
+ * The header is fixed apart from the compression level hint, the trailer
+ * holds the CRC-32 and the input size in little endian.
+ */
+TEST(gzip_stream)
+{
+	static const char input[] = "<svg><rect/><rect/><rect/><rect/></svg>";
+	static qr_deflate deflate;
+	qr_buffer buffer = { 0 };
+	qr_sink sink, compressed;
+	const uint8_t *trailer;
+	uint32_t crc;
+
+	qr_sink_memory(&sink, &buffer);
+	qr_deflate_init(&deflate, QR_DEFLATE_GZIP, QR_DEFLATE_BEST, &sink);
+	qr_deflate_sink(&compressed, &deflate);
+	qr_sink_puts(&compressed, input);
+	qr_sink_flush(&compressed);
+	qr_deflate_finish(&deflate);
+	qr_sink_flush(&sink);
+
+	test_expect_eq(memcmp(buffer.data, "\x1F\x8B\x08\0\0\0\0\0\x02\xFF", 10), 0, "Header bytes");
+	test_expect_eq(buffer.data[10] & 0x7, 0x4, "First block uses dynamic Huffman codes");
+
+	trailer = (const uint8_t *) buffer.data + buffer.length - 8;
+	crc = trailer[0] | trailer[1] << 8 | trailer[2] << 16 | (uint32_t) trailer[3] << 24;
+	test_expect_eq(crc, qr_crc32(0, input, strlen(input)), "Trailer holds the CRC-32");
+	test_expect_eq(trailer[4], strlen(input), "Trailer holds the input size");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the code lengths of skewed frequencies
+ *
+ * Fibonacci frequencies make an unlimited Huffman tree as deep as the
+ * alphabet, the limited code must still be complete.
+ */
+TEST(huffman_lengths)
+{
+	uint32_t frequencies[CODE_LENGTHS], kraft = 0;
+	uint8_t lengths[CODE_LENGTHS];
+	size_t i;
+
+	frequencies[0] = frequencies[1] = 1;
+	for (i = 2; i < CODE_LENGTHS; ++i)
+		frequencies[i] = frequencies[i - 1] + frequencies[i - 2];
+
+	build_lengths(frequencies, CODE_LENGTHS, MAX_CODE_LENGTH_LENGTH, lengths);
+	for (i = 0; i < CODE_LENGTHS; ++i)
+	{
+		test_expect_le(lengths[i], MAX_CODE_LENGTH_LENGTH, "Length within the limit");
+		test_expect_ge(lengths[i], 1, "Every used symbol has a code");
+		kraft += 1u << (MAX_CODE_LENGTH_LENGTH - lengths[i]);
+	}
+	test_expect_eq(kraft, 1u << MAX_CODE_LENGTH_LENGTH, "Code is complete");
+	test_expect_le(lengths[CODE_LENGTHS - 1], lengths[0], "Frequent symbols get shorter codes");
+
+	memset(frequencies, 0, sizeof(frequencies));
+	frequencies[5] = 10;
+	build_lengths(frequencies, CODE_LENGTHS, MAX_CODE_LENGTH_LENGTH, lengths);
+	test_expect_eq(lengths[5], 1, "Single symbol code");
+	test_expect_eq(lengths[0], 1, "Padded with a second symbol");
+
+	return TEST_SUCCESS;
+}
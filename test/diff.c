@@ -0,0 +1,95 @@
+/**
+ * @file diff.c
+ * @brief Test cases for the changes between two symbols
+ *
+ * This file contains test cases for the rectangles of changed modules and
+ * their text and binary encodings.
+ */
+
+#include <test/base.h>
+#include <qr/matrix.h>
+#include <qr/qr.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stdint.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/diff.c"
+
+/**
+ * @brief Test that applying the rectangles turns one symbol into the other
+ *
+ * Every module inside a rectangle must change to its state, the modules
+ * outside of all rectangles must already be equal.
+ */
+TEST(rects_update_symbol)
+{
+	qr_code *previous = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 10);
+	qr_code *next = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 10);
+	size_t n = next->side_length, count, k, i, j, changed = 0;
+	static int matrix[61 * 61];
+	static char covered[61 * 61];
+	qr_diff_rect *rects;
+
+	qr_encode_message(previous, "https://example.com/ticket/0001");
+	qr_encode_message(next, "https://example.com/ticket/0002");
+	test_expect_eq(n, 61, "Version 11 is 61 modules wide");
+
+	rects = qr_diff(previous, next, &count);
+	memcpy(matrix, previous->matrix, sizeof(matrix));
+	for (k = 0; k < count; ++k)
+	{
+		for (i = rects[k].rect.y; i < rects[k].rect.y + rects[k].rect.height; ++i)
+		{
+			for (j = rects[k].rect.x; j < rects[k].rect.x + rects[k].rect.width; ++j)
+			{
+				test_expect_eq(covered[i * n + j], 0, "Rectangles are disjoint");
+				test_expect_ne(qr_module_get(previous, i, j), qr_module_get(next, i, j), "Only changed modules are covered");
+				covered[i * n + j] = 1;
+				matrix[i * n + j] = rects[k].dark;
+				++changed;
+			}
+		}
+	}
+
+	for (i = 0; i < n * n; ++i)
+		test_expect_eq(!matrix[i], !next->matrix[i], "Updated module matches");
+	test_expect_lt(count, changed, "Neighbouring changes are merged");
+	free(rects);
+
+	rects = qr_diff(next, next, &count);
+	test_expect_eq(count, 0, "Nothing changes between equal symbols");
+	free(rects);
+
+	qr_destroy(previous);
+	qr_destroy(next);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the text and binary encodings of the rectangles
+ */
+TEST(encodings)
+{
+	static const qr_diff_rect rects[] = { { { 3, 4, 5, 1 }, 1 }, { { 0, 20, 1, 2 }, 0 } };
+	static const uint8_t binary[] = { 0, 0, 0, 2, 3, 4, 5, 1, 1, 0, 20, 1, 2, 0 };
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+
+	qr_sink_memory(&sink, &buffer);
+	qr_diff_render_text(rects, 2, &sink);
+	qr_sink_flush(&sink);
+	test_expect_eq(buffer.length, strlen("3 4 5 1 1\n0 20 1 2 0\n"), "Text length");
+	test_expect_eq(memcmp(buffer.data, "3 4 5 1 1\n0 20 1 2 0\n", buffer.length), 0, "Text lines");
+
+	buffer.length = 0;
+	qr_sink_memory(&sink, &buffer);
+	qr_diff_render_binary(rects, 2, &sink);
+	qr_sink_flush(&sink);
+	test_expect_eq(buffer.length, sizeof(binary), "Binary length");
+	test_expect_eq(memcmp(buffer.data, binary, sizeof(binary)), 0, "Binary records");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,310 @@
+/**
+ * @file driver.c
+ * @brief Test cases for encoding batches of records
+ *
+ * This file contains test cases for the outputs of delimited and corpus
+ * batches in input order or as they complete, with shards, the manifest,
+ * the output cache and failed records.
+ */
+
+#include <test/base.h>
+#include <qr/batch.h>
+#include <qr/driver.h>
+#include <qr/input.h>
+#include <qr/output.h>
+#include <qr/qr.h>
+#include <qr/sink.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Include the source file directly to test static functions
+#include "../qr/driver.c"
+
+static const qr_input_options ENCODE = { .mode = QR_MODE_BYTE, .optimize = 1, .eci = -1, .level = QR_EC_LEVEL_M, .min_version = 0, .max_version = QR_VERSION_COUNT - 1, .ec_pool = NULL, .split = 1, .quiet = 1, .store = NULL };
+static const qr_raster_options RASTER = { .scale = 4, .quiet_zone = QR_QUIET_ZONE };
+static const qr_output_options OUTPUT = { .path = NULL, .gzip = NULL, .level = QR_DEFLATE_FAST };
+
+/**
+ * @brief Writes data to a new temporary file and returns its path
+ */
+static char *
+write_temporary(const void *data, size_t size)
+{
+	char *path = test_malloc(32);
+	FILE *file;
+	int fd;
+
+	strcpy(path, "/tmp/qr-driver-XXXXXX");
+	if ((fd = mkstemp(path)) < 0) return NULL;
+
+	file = fdopen(fd, "wb");
+	fwrite(data, 1, size, file);
+	fclose(file);
+	return path;
+}
+
+/**
+ * @brief Runs a batch with the output in a temporary file and reads it back
+ */
+static int
+run(qr_driver_options *options, qr_input_options *encode, qr_buffer *output)
+{
+	char chunk[4096];
+	size_t read;
+	int status;
+
+	options->out = tmpfile();
+	status = qr_driver_run(options, encode, QR_FORMAT_SVG, &RASTER, &OUTPUT);
+
+	output->length = 0;
+	rewind(options->out);
+	while ((read = fread(chunk, 1, sizeof(chunk), options->out)))
+	{
+		output->data = realloc(output->data, output->length + read);
+		memcpy(output->data + output->length, chunk, read);
+		output->length += read;
+	}
+	fclose(options->out);
+	return status;
+}
+
+/**
+ * @brief Checks that the next record of output is the symbol of input and
+ * moves offset past it, a NULL input expects the empty record of a failure
+ */
+static int
+is_next_record(const qr_buffer *output, size_t *offset, int numbered, size_t number, const qr_input_options *options, const char *input)
+{
+	const unsigned char *bytes = (const unsigned char *) output->data + *offset;
+	qr_input_options encode = *options;
+	qr_code *symbols[QR_APPEND_MAX_SYMBOLS];
+	qr_buffer expected = { 0 };
+	size_t length;
+	qr_sink sink;
+	int same;
+
+	if (input)
+	{
+		qr_input_encode(input, strlen(input), &encode, NULL, symbols);
+		qr_sink_memory(&sink, &expected);
+		qr_render(symbols[0], QR_FORMAT_SVG, &RASTER, &sink);
+		qr_sink_flush(&sink);
+		qr_destroy(symbols[0]);
+	}
+
+	if (numbered)
+	{
+		if (output->length - *offset < 4 || (size_t) (bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3]) != number)
+			return 0;
+		bytes += 4;
+		*offset += 4;
+	}
+
+	length = output->length - *offset < 4 ? SIZE_MAX : (size_t) (bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3]);
+	same = length == expected.length && output->length - *offset - 4 >= length && !memcmp(bytes + 4, expected.data, length);
+	*offset += 4 + length;
+
+	qr_buffer_free(&expected);
+	return same;
+}
+
+/**
+ * @brief Test that delimited records are written in input order
+ *
+ * Empty lines are records too.
+ */
+TEST(ordered_records)
+{
+	static const char lines[] = "alpha\nbeta\n\ngamma";
+	const char *expected[] = { "alpha", "beta", "", "gamma" };
+	qr_driver_options options = { .input = write_temporary(lines, strlen(lines)), .delimiter = '\n', .threads = 2, .ordered = 1, .shard = 1, .shard_count = 1 };
+	qr_input_options encode = ENCODE;
+	qr_buffer output = { 0 };
+	size_t i, offset = 0;
+
+	test_expect_eq(options.input != NULL, 1, "Input is written");
+	test_expect_eq(run(&options, &encode, &output), 0, "Batch is encoded");
+	for (i = 0; i < 4; ++i)
+		test_expect_eq(is_next_record(&output, &offset, 0, 0, &ENCODE, expected[i]), 1, "Records follow the input order");
+	test_expect_eq(offset, output.length, "No other records");
+
+	unlink(options.input);
+	qr_buffer_free(&output);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that records stay in input order once the queue wraps around
+ *
+ * Two workers queue 128 records, the batch has 300 of different sizes.
+ */
+TEST(queue_wraps)
+{
+	qr_driver_options options = { .delimiter = '\n', .threads = 2, .ordered = 1, .shard = 1, .shard_count = 1 };
+	qr_input_options encode = ENCODE;
+	qr_buffer lines = { 0 }, output = { 0 };
+	char line[128];
+	size_t i, offset = 0;
+	qr_sink sink;
+
+	qr_sink_memory(&sink, &lines);
+	for (i = 0; i < 300; ++i)
+	{
+		snprintf(line, sizeof(line), "%zu-%.*s\n", i, (int) (i * 7 % 100), "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789");
+		qr_sink_puts(&sink, line);
+	}
+	qr_sink_flush(&sink);
+	options.input = write_temporary(lines.data, lines.length);
+
+	test_expect_eq(run(&options, &encode, &output), 0, "Batch is encoded");
+	for (i = 0; i < 300; ++i)
+	{
+		snprintf(line, sizeof(line), "%zu-%.*s", i, (int) (i * 7 % 100), "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789");
+		test_expect_eq(is_next_record(&output, &offset, 0, 0, &ENCODE, line), 1, "Records follow the input order");
+	}
+	test_expect_eq(offset, output.length, "No other records");
+
+	unlink(options.input);
+	qr_buffer_free(&lines);
+	qr_buffer_free(&output);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that records are pushed round-robin and idle workers steal
+ *
+ * Workers take the oldest record of their own deque and steal the newest
+ * of the next deque once their own is empty.
+ */
+TEST(steal_records)
+{
+	size_t numbers[3][8], number, i;
+	batch_worker workers[3] = { 0 };
+	batch_context batch = { .workers = workers, .worker_count = 3, .slot_count = 8 };
+
+	for (i = 0; i < 3; ++i)
+	{
+		pthread_mutex_init(&workers[i].queue.lock, NULL);
+		workers[i].queue.numbers = numbers[i];
+	}
+	for (i = 0; i < 7; ++i)
+		push_record(&batch, i);
+	test_expect_eq(workers[0].queue.last - workers[0].queue.first, 3, "Every third record goes to the first worker");
+
+	test_expect_eq(take_record(&batch, 1, &number) && number == 1, 1, "Own oldest record is taken");
+	test_expect_eq(take_record(&batch, 1, &number) && number == 4, 1, "Next own record is taken");
+	test_expect_eq(take_record(&batch, 1, &number) && number == 5, 1, "Empty deque steals the newest of the next");
+	test_expect_eq(take_record(&batch, 2, &number) && number == 2, 1, "Stolen record is not taken again");
+	test_expect_eq(take_record(&batch, 2, &number) && number == 6, 1, "First deque is robbed after the own");
+	test_expect_eq(take_record(&batch, 0, &number) && number == 0, 1, "Owner keeps its oldest records");
+	test_expect_eq(take_record(&batch, 0, &number) && number == 3, 1, "Owner takes its last record");
+	test_expect_eq(take_record(&batch, 1, &number), 0, "Nothing is left");
+
+	for (i = 0; i < 3; ++i)
+		pthread_mutex_destroy(&workers[i].queue.lock);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test a shard of unordered records and its manifest
+ */
+TEST(shard_manifest)
+{
+	static const char lines[] = "r1\nr2\nr3\nr4\nr5";
+	char *manifest = write_temporary("", 0), line[64];
+	qr_driver_options options = { .input = write_temporary(lines, strlen(lines)), .delimiter = '\n', .threads = 3, .ordered = 0, .shard = 2, .shard_count = 2, .manifest = manifest };
+	qr_input_options encode = ENCODE;
+	qr_buffer output = { 0 };
+	size_t offset = 0, number, size, seen = 0, count = 0;
+	FILE *file;
+
+	test_expect_eq(run(&options, &encode, &output), 0, "Shard is encoded");
+	while (offset < output.length)
+	{
+		number = (unsigned char) output.data[offset] << 24 | (unsigned char) output.data[offset + 1] << 16 | (unsigned char) output.data[offset + 2] << 8 | (unsigned char) output.data[offset + 3];
+		snprintf(line, sizeof(line), "r%zu", number);
+		test_expect_eq(qr_batch_shard(number, line, 2, 2, 0), 2, "Record belongs to the shard");
+		test_expect_eq(is_next_record(&output, &offset, 1, number, &ENCODE, line), 1, "Numbered record has the symbol of its input");
+		seen |= 1 << number;
+		++count;
+	}
+	test_expect_eq(count, 2, "Two of five records are in the second shard");
+
+	file = fopen(manifest, "r");
+	for (count = 0; fgets(line, sizeof(line), file); ++count)
+	{
+		test_expect_eq(sscanf(line, "%zu %zu", &number, &size), 2, "Manifest line has the number and the size");
+		test_expect_ne(seen & (1 << number), 0, "Manifest lists a written record");
+	}
+	fclose(file);
+	test_expect_eq(count, 2, "One manifest line per record");
+
+	unlink(options.input);
+	unlink(manifest);
+	qr_buffer_free(&output);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test a corpus batch with an index and repeated records from the
+ * cache
+ */
+TEST(corpus_cache)
+{
+	const char *records[] = { "x", "y", "x", "x" };
+	qr_driver_options options = { .mapped = 1, .threads = 2, .ordered = 1, .shard = 1, .shard_count = 1, .cache_size = 1 << 20 };
+	qr_input_options encode = ENCODE;
+	qr_buffer corpus = { 0 }, output = { 0 };
+	char index[32];
+	size_t i, offset = 0;
+	qr_sink sink;
+
+	qr_sink_memory(&sink, &corpus);
+	for (i = 0; i < 4; ++i)
+		qr_batch_put_record(&sink, records[i], 1);
+	qr_sink_flush(&sink);
+	options.input = write_temporary(corpus.data, corpus.length);
+	snprintf(index, sizeof(index), "%s.idx", options.input);
+	options.index = index;
+
+	test_expect_eq(run(&options, &encode, &output), 0, "Corpus is encoded");
+	for (i = 0; i < 4; ++i)
+		test_expect_eq(is_next_record(&output, &offset, 0, 0, &ENCODE, records[i]), 1, "Cached records are unchanged");
+	test_expect_eq(access(index, F_OK), 0, "Index of the corpus is written");
+
+	test_expect_eq(run(&options, &encode, &output), 0, "Corpus is encoded with its index");
+	for (i = 0, offset = 0; i < 4; ++i)
+		test_expect_eq(is_next_record(&output, &offset, 0, 0, &ENCODE, records[i]), 1, "Records found by the index");
+
+	unlink(options.input);
+	unlink(index);
+	qr_buffer_free(&corpus);
+	qr_buffer_free(&output);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a failed record leaves an empty record and fails the batch
+ */
+TEST(failed_record)
+{
+	static const char lines[] = "123\nabc\n456";
+	qr_driver_options options = { .input = write_temporary(lines, strlen(lines)), .delimiter = '\n', .threads = 2, .ordered = 1, .shard = 1, .shard_count = 1 };
+	qr_input_options encode = ENCODE;
+	qr_buffer output = { 0 };
+	size_t offset = 0;
+
+	encode.optimize = 0;
+	encode.mode = QR_MODE_NUMERIC;
+	test_expect_eq(run(&options, &encode, &output), -1, "Batch with a failed record fails");
+	test_expect_eq(is_next_record(&output, &offset, 0, 0, &encode, "123"), 1, "Record before the failure");
+	test_expect_eq(is_next_record(&output, &offset, 0, 0, &encode, NULL), 1, "Failed record is empty");
+	test_expect_eq(is_next_record(&output, &offset, 0, 0, &encode, "456"), 1, "Record after the failure");
+	test_expect_eq(offset, output.length, "No other records");
+
+	unlink(options.input);
+	qr_buffer_free(&output);
+	return TEST_SUCCESS;
+}
@@ -7,6 +7,7 @@
  */
 
 #include <test/base.h>
+#include <qr/pool.h>
 #include <qr/types.h>
 #include <stdio.h>
 
@@ -102,8 +103,14 @@ TEST(ecc_generation) {
 	// Generate the generator polynomial for 10 ECC codewords
 	generator_polynomial(g, 10);
 
+	// The precomputed generator holds the logarithms of the same coefficients
+	for (int i = 0; i < 10; i++) {
+		test_expect_eq(gf_antilog[generator_logs[10][i]], g[i],
+			"Precomputed generator mismatch");
+	}
+
 	// Generate ECC
-	ecc_generate(data, 7, ecc, 10, g);
+	ecc_generate(data, 7, ecc, 10, generator_logs[10]);
 
 	// Expected ECC values for the test data
 	word expected_ecc[10] = {214, 246, 18, 193, 38, 69, 160, 197, 199, 15};
@@ -345,6 +352,55 @@ TEST(codeword_interleaving_version8_m) {
 	return TEST_SUCCESS;
 }
 
+/**
+ * @brief Test parallel and per-block ec encoding
+ *
+ * Version 40-H has 81 blocks of two sizes. Encoding them on a pool of
+ * threads, twice with the same workers, or one block at a time must produce
+ * the same codewords as the sequential encoder.
+ */
+TEST(qr_ec_encode_parallel_version40_h) {
+	const size_t data_count = TOTAL_DATA_CODEWORD_COUNT[QR_EC_LEVEL_H][39];
+	const size_t total_cw = CODEWORD_COUNT[39];
+	word sequential[total_cw], parallel[total_cw], blockwise[total_cw], fallback[total_cw];
+	qr_pool pool;
+	qr_code qr = {
+		.level = QR_EC_LEVEL_H,
+		.version = 39,
+		.mode = QR_MODE_BYTE,
+		.codeword_count = total_cw
+	};
+
+	for (size_t i = 0; i < data_count; ++i)
+		sequential[i] = parallel[i] = blockwise[i] = fallback[i] = (word) ((i * 31 + 3) % 256);
+
+	test_expect_eq(qr_ec_block_count(&qr), 81, "Block count of version 40-H");
+
+	qr.codewords = sequential;
+	qr_ec_encode(&qr);
+
+	qr_pool_init(&pool, 4);
+	qr.codewords = parallel;
+	qr_ec_encode_parallel(&qr, &pool);
+	qr_ec_encode_parallel(&qr, &pool);
+	qr_pool_destroy(&pool);
+
+	qr.codewords = fallback;
+	qr_ec_encode_parallel(&qr, NULL);
+
+	qr.codewords = blockwise;
+	for (size_t block = qr_ec_block_count(&qr) - 1; block < qr_ec_block_count(&qr); --block)
+		qr_ec_encode_block(&qr, block);
+
+	for (size_t i = 0; i < total_cw; ++i) {
+		test_expect_eq(parallel[i], sequential[i], "Parallel encoding differs from sequential encoding");
+		test_expect_eq(blockwise[i], sequential[i], "Per-block encoding differs from sequential encoding");
+		test_expect_eq(fallback[i], sequential[i], "Encoding without a pool differs from sequential encoding");
+	}
+
+	return TEST_SUCCESS;
+}
+
 /**
  * @brief Test the consistency of ECC tables
  *
@@ -0,0 +1,298 @@
+/**
+ * @file enc.c
+ * @brief Test cases for data encoding
+ *
+ * This file contains test cases for the data encoding module, including
+ * version selection per encoding mode, the bit streams of the individual
+ * modes, mixed-mode segmentation and Shift-JIS conversion.
+ */
+
+#include <test/base.h>
+#include <qr/sjis.h>
+#include <qr/types.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/enc.c"
+
+/**
+ * @brief Test kanji character compaction
+ *
+ * Verifies the 13 bit values of the examples given in ISO/IEC 18004
+ * for both Shift-JIS ranges.
+ */
+TEST(kanji_value)
+{
+	test_expect_eq(kanji_value("\x93\x5F"), 0x0D9F, "Kanji value of 0x935F");
+	test_expect_eq(kanji_value("\xE4\xAA"), 0x1AAA, "Kanji value of 0xE4AA");
+	test_expect_eq(kanji_value("\x81\x40"), 0x0000, "Kanji value of lowest code");
+	test_expect_eq(kanji_value("\xEB\xBF"), 0x1FFF, "Kanji value of highest code");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test version selection against the capacity tables of the specification
+ *
+ * The largest message fitting a version must select exactly that version,
+ * one more character must select the next one.
+ */
+TEST(min_version_capacity)
+{
+	char message[2 * 1817 + 2];
+	qr_segment segment = { .mode = QR_MODE_BYTE, .data = message };
+
+	memset(message, 'a', sizeof(message));
+
+	segment.length = 17;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_L), 0, "17 bytes fit version 1-L");
+	segment.length = 18;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_L), 1, "18 bytes need version 2-L");
+
+	segment.length = 2331;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_M), 39, "2331 bytes fit version 40-M");
+	segment.length = 2332;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_M), QR_VERSION_COUNT, "2332 bytes do not fit");
+
+	memset(message, '7', sizeof(message));
+	segment.mode = QR_MODE_NUMERIC;
+	segment.length = 41;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_L), 0, "41 digits fit version 1-L");
+	segment.length = 42;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_L), 1, "42 digits need version 2-L");
+
+	segment.mode = QR_MODE_ALPHANUMERIC;
+	segment.length = 2420;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_Q), 39, "2420 characters fit version 40-Q");
+	segment.length = 2421;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_Q), QR_VERSION_COUNT, "2421 characters do not fit");
+
+	for (size_t i = 0; i < sizeof(message); i += 2)
+		memcpy(message + i, "\x88\x9F", 2);
+	segment.mode = QR_MODE_KANJI;
+	segment.length = 2 * 4;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_H), 0, "4 kanji fit version 1-H");
+	segment.length = 2 * 5;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_H), 1, "5 kanji need version 2-H");
+
+	segment.length = 2 * 1817;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_L), 39, "1817 kanji fit version 40-L");
+	segment.length = 2 * 1818;
+	test_expect_eq(qr_min_version(&segment, 1, QR_EC_LEVEL_L), QR_VERSION_COUNT, "1818 kanji do not fit");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the numeric and alphanumeric mode bit streams
+ *
+ * Encodes the examples given in ISO/IEC 18004 as two segments of a
+ * version 1-M symbol.
+ */
+TEST(numeric_alphanumeric_bit_stream)
+{
+	word codewords[16];
+	qr_code qr = { .level = QR_EC_LEVEL_M, .version = 0, .codewords = codewords };
+	qr_segment segments[2] =
+	{
+		{ .mode = QR_MODE_NUMERIC, .data = "01234567", .length = 8 },
+		{ .mode = QR_MODE_ALPHANUMERIC, .data = "AC-42", .length = 5 },
+	};
+
+	qr_encode_data(&qr, segments, 2);
+
+	// 0001 0000001000 0000001100 0101011001 1000011
+	// 0010 000000101 00111001110 11100111001 000010
+	test_expect_eq(codewords[0], 0x10, "Numeric mode indicator and character count");
+	test_expect_eq(codewords[1], 0x20, "Numeric character count and data");
+	test_expect_eq(codewords[2], 0x0C, "Numeric data");
+	test_expect_eq(codewords[3], 0x56, "Numeric data");
+	test_expect_eq(codewords[4], 0x61, "Numeric data");
+	test_expect_eq(codewords[5], 0x90, "Numeric remainder and alphanumeric mode indicator");
+	test_expect_eq(codewords[6], 0x14, "Alphanumeric character count and data");
+	test_expect_eq(codewords[7], 0xE7, "Alphanumeric data");
+	test_expect_eq(codewords[8], 0x73, "Alphanumeric data");
+	test_expect_eq(codewords[9], 0x90, "Alphanumeric remainder");
+	test_expect_eq(codewords[10], 0x80, "Alphanumeric remainder and terminator");
+	test_expect_eq(codewords[11], 0xEC, "First pad codeword");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the kanji mode bit stream
+ *
+ * Encodes two characters into a version 1-H symbol and checks the mode
+ * indicator, character count, data and padding codewords.
+ */
+TEST(kanji_bit_stream)
+{
+	word codewords[26];
+	qr_code qr = { .level = QR_EC_LEVEL_H, .version = 0, .codewords = codewords };
+	qr_segment segment = { .mode = QR_MODE_KANJI, .data = "\x93\x5F\xE4\xAA", .length = 4 };
+
+	qr_encode_data(&qr, &segment, 1);
+
+	// 1000 00000010 0110110011111 1101010101010 0000 (terminator) 000000 (padding)
+	test_expect_eq(codewords[0], 0x80, "Mode indicator and character count");
+	test_expect_eq(codewords[1], 0x26, "Character count and first character");
+	test_expect_eq(codewords[2], 0xCF, "First character");
+	test_expect_eq(codewords[3], 0xEA, "Second character");
+	test_expect_eq(codewords[4], 0xA8, "Second character and terminator");
+	test_expect_eq(codewords[5], 0x00, "Terminator and bit padding");
+	test_expect_eq(codewords[6], 0xEC, "First pad codeword");
+	test_expect_eq(codewords[7], 0x11, "Second pad codeword");
+	test_expect_eq(codewords[8], 0xEC, "Last pad codeword");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test segment validation
+ *
+ * Verifies that characters outside of the character set of a mode are
+ * rejected.
+ */
+TEST(segment_validation)
+{
+	qr_segment segment = { .mode = QR_MODE_NUMERIC, .data = "0123A", .length = 4 };
+
+	test_expect_eq(qr_segment_is_valid(&segment), 1, "Digits are valid in numeric mode");
+	segment.length = 5;
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Letters are invalid in numeric mode");
+
+	segment = (qr_segment) { .mode = QR_MODE_ALPHANUMERIC, .data = "AZ $%*+-./:a", .length = 11 };
+	test_expect_eq(qr_segment_is_valid(&segment), 1, "Alphanumeric character set is valid");
+	segment.length = 12;
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Lowercase letters are invalid in alphanumeric mode");
+
+	segment = (qr_segment) { .mode = QR_MODE_KANJI, .data = "\x93\x5F\xF0\x40", .length = 2 };
+	test_expect_eq(qr_segment_is_valid(&segment), 1, "Kanji is valid in kanji mode");
+	segment.length = 3;
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Odd length is invalid in kanji mode");
+	segment.length = 4;
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Codes outside of JIS X 0208 are invalid in kanji mode");
+
+	segment = (qr_segment) { .mode = QR_MODE_KANJI, .data = "\x82\x00", .length = 2 };
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Trail byte below 0x40 is invalid in kanji mode");
+	segment.data = "\x82\x7F";
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Trail byte 0x7F is invalid in kanji mode");
+	segment.data = "\x82\xFD";
+	test_expect_eq(qr_segment_is_valid(&segment), 0, "Trail byte above 0xFC is invalid in kanji mode");
+	segment = (qr_segment) { .mode = QR_MODE_BYTE, .data = "\x82\x00", .length = 2 };
+	test_expect_eq(qr_segment_is_valid(&segment), 1, "Invalid pair is kept as bytes");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test mixed-mode segmentation
+ *
+ * Verifies that runs long enough to pay for their header get their own
+ * segment while short runs are merged into the surrounding segment.
+ */
+TEST(segments_optimize)
+{
+	qr_segment segments[64];
+	unsigned version;
+	size_t count;
+	const char *url = "https://EX.COM/ITEM/000123456789";
+
+	count = qr_segments_optimize(url, strlen(url), 0, QR_EC_LEVEL_M, segments, 0, &version);
+	test_expect_eq(count, 3, "URL is split into three segments");
+	test_expect_eq(segments[0].mode, QR_MODE_BYTE, "Scheme is encoded in byte mode");
+	test_expect_eq(segments[0].length, 5, "Scheme segment length");
+	test_expect_eq(segments[1].mode, QR_MODE_ALPHANUMERIC, "Host and path are encoded in alphanumeric mode");
+	test_expect_eq(segments[1].length, 15, "Host and path segment length");
+	test_expect_eq(segments[2].mode, QR_MODE_NUMERIC, "Item number is encoded in numeric mode");
+	test_expect_eq(segments[2].length, 12, "Item number segment length");
+	test_expect_eq(version, 1, "Mixed segments fit version 2-M");
+
+	count = qr_segments_optimize("a1b", 3, 0, QR_EC_LEVEL_M, segments, 0, &version);
+	test_expect_eq(count, 1, "Single digit does not justify a segment");
+	test_expect_eq(segments[0].mode, QR_MODE_BYTE, "Single digit is merged into byte mode");
+
+	count = qr_segments_optimize("", 0, 0, QR_EC_LEVEL_M, segments, 0, &version);
+	test_expect_eq(count, 1, "Empty input yields one segment");
+	test_expect_eq(segments[0].length, 0, "Empty segment");
+	test_expect_eq(version, 0, "Empty input fits version 1");
+
+	count = qr_segments_optimize("\x93\x5F\xE4\xAA" "12345678", 12, 1, QR_EC_LEVEL_M, segments, 0, &version);
+	test_expect_eq(count, 2, "Kanji followed by digits yields two segments");
+	test_expect_eq(segments[0].mode, QR_MODE_KANJI, "Double-byte characters are encoded in kanji mode");
+	test_expect_eq(segments[0].length, 4, "Kanji segment length");
+	test_expect_eq(segments[1].mode, QR_MODE_NUMERIC, "Digits are encoded in numeric mode");
+
+	count = qr_segments_optimize("\x93\x5F\x82\x00", 4, 1, QR_EC_LEVEL_M, segments, 0, &version);
+	test_expect_eq(segments[count - 1].mode, QR_MODE_BYTE, "Pair with an invalid trail byte is not encoded in kanji mode");
+
+	count = qr_segments_optimize("a" "\x8A\xBF" "b", 4, 1, QR_EC_LEVEL_M, segments, 0, &version);
+	test_expect_eq(count, 1, "Single kanji between ASCII does not justify a segment");
+	test_expect_eq(segments[0].mode, QR_MODE_BYTE, "Kanji is merged into byte mode");
+	test_expect_eq(segments[0].length, 4, "Byte segment holds both bytes of the kanji");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test ECI segments
+ *
+ * Verifies the designator length for each assignment number range, the
+ * bit stream of a UTF-8 declaration and that the designator is taken into
+ * account by the version selection of the segmentation.
+ */
+TEST(eci_segment)
+{
+	word codewords[16];
+	qr_code qr = { .level = QR_EC_LEVEL_M, .version = 0, .codewords = codewords };
+	qr_segment segments[2 + 14] =
+	{
+		{ .mode = QR_MODE_ECI, .eci = QR_ECI_UTF8 },
+		{ .mode = QR_MODE_BYTE, .data = "A", .length = 1 },
+	};
+	unsigned version;
+
+	test_expect_eq(qr_segment_bits(&(qr_segment) { .mode = QR_MODE_ECI, .eci = 127 }, 0), 12, "One byte designator");
+	test_expect_eq(qr_segment_bits(&(qr_segment) { .mode = QR_MODE_ECI, .eci = 128 }, 0), 20, "Two byte designator");
+	test_expect_eq(qr_segment_bits(&(qr_segment) { .mode = QR_MODE_ECI, .eci = 16384 }, 0), 28, "Three byte designator");
+
+	qr_encode_data(&qr, segments, 2);
+
+	// 0111 00011010 0100 00000001 01000001
+	test_expect_eq(codewords[0], 0x71, "ECI mode indicator and designator");
+	test_expect_eq(codewords[1], 0xA4, "Designator and byte mode indicator");
+	test_expect_eq(codewords[2], 0x01, "Character count");
+	test_expect_eq(codewords[3], 0x41, "Data");
+
+	qr_segments_optimize("abcdefghijklmn", 14, 0, QR_EC_LEVEL_M, segments + 1, 0, &version);
+	test_expect_eq(version, 0, "14 bytes fit version 1-M");
+	qr_segments_optimize("abcdefghijklmn", 14, 0, QR_EC_LEVEL_M, segments, 1, &version);
+	test_expect_eq(segments[0].mode, QR_MODE_ECI, "ECI segment is kept in front");
+	test_expect_eq(version, 1, "14 bytes with ECI need version 2-M");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test UTF-8 to Shift-JIS conversion
+ *
+ * Verifies the mapping of kana, kanji and ASCII as well as the rejection
+ * of characters outside of JIS X 0208.
+ */
+TEST(utf8_to_sjis)
+{
+	char out[16];
+
+	test_expect_eq(qr_utf8_to_sjis("\xE7\x82\xB9\xE8\x8C\x97", 6, out), 4, "Length of converted kanji");
+	test_expect_eq(memcmp(out, "\x93\x5F\xE4\xAA", 5), 0, "Converted kanji");
+
+	test_expect_eq(qr_utf8_to_sjis("a\xE3\x81\x82", 4, out), 3, "Length of converted ASCII and hiragana");
+	test_expect_eq(memcmp(out, "a\x82\xA0", 4), 0, "Converted ASCII and hiragana");
+
+	test_expect_eq(qr_utf8_to_sjis("\xF0\x9F\x98\x80", 4, out) == QR_SJIS_INVALID, 1, "Emoji is not mappable");
+	test_expect_eq(qr_utf8_to_sjis("\xE7\x82", 2, out) == QR_SJIS_INVALID, 1, "Truncated sequence is rejected");
+	test_expect_eq(qr_utf8_to_sjis("ab\xE3\x81\x82", 3, out) == QR_SJIS_INVALID, 1, "Sequence cut off by the size is rejected");
+	test_expect_eq(qr_utf8_to_sjis("ab\xE3\x81\x82", 2, out), 2, "Only the given size is converted");
+
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file input.c
+ * @brief Test cases for encoding inputs into symbols
+ *
+ * This file contains test cases for the encoding of one input with the
+ * command-line options, structured append, reused symbols and the symbol
+ * store.
+ */
+
+#include <test/base.h>
+#include <qr/input.h>
+#include <qr/qr.h>
+#include <qr/store.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Include the source file directly to test static functions
+#include "../qr/input.c"
+
+static const qr_input_options DEFAULTS = { .mode = QR_MODE_BYTE, .optimize = 1, .eci = -1, .level = QR_EC_LEVEL_M, .min_version = 0, .max_version = QR_VERSION_COUNT - 1, .ec_pool = NULL, .split = 1, .quiet = 1, .store = NULL };
+
+/**
+ * @brief Test encoding with a fixed mode, the smallest version and reuse
+ */
+TEST(encode_modes)
+{
+	qr_input_options options = DEFAULTS;
+	qr_code *symbols[QR_APPEND_MAX_SYMBOLS], *reuse = qr_create(QR_EC_LEVEL_L, QR_MODE_NUMERIC, 20);
+
+	test_expect_eq(qr_input_encode("HELLO WORLD", 11, &options, NULL, symbols), 1, "One symbol");
+	test_expect_eq(symbols[0]->version, 0, "Smallest version");
+	qr_destroy(symbols[0]);
+
+	options.min_version = 4;
+	test_expect_eq(qr_input_encode("HELLO WORLD", 11, &options, reuse, symbols), 1, "Symbol is encoded into reuse");
+	test_expect_eq(symbols[0] == reuse, 1, "Reused symbol is returned");
+	test_expect_eq(reuse->version, 4, "Minimum version is kept");
+
+	options.optimize = 0;
+	options.mode = QR_MODE_NUMERIC;
+	test_expect_eq(qr_input_encode("12a", 3, &options, NULL, symbols), 0, "Letters are not numeric");
+	options.mode = QR_MODE_KANJI;
+	test_expect_eq(qr_input_encode("abc", 3, &options, NULL, symbols), 0, "ASCII is not kanji");
+	test_expect_eq(strcmp(qr_input_mode_name(QR_MODE_ALPHANUMERIC), "alphanumeric"), 0, "Mode name");
+
+	qr_destroy(reuse);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that input exceeding the largest version is split if allowed
+ */
+TEST(structured_append)
+{
+	qr_input_options options = DEFAULTS;
+	qr_code *symbols[QR_APPEND_MAX_SYMBOLS];
+	char input[100];
+	size_t i, count;
+
+	memset(input, 'x', sizeof(input));
+	options.max_version = 0;
+	count = qr_input_encode(input, sizeof(input), &options, NULL, symbols);
+	test_expect_gt(count, 1, "Input is split");
+	for (i = 0; i < count; ++i)
+	{
+		test_expect_eq(symbols[i]->version, 0, "Every symbol has the largest version");
+		qr_destroy(symbols[i]);
+	}
+
+	options.split = 0;
+	test_expect_eq(qr_input_encode(input, sizeof(input), &options, NULL, symbols), 0, "Input is too large without split");
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a stored symbol is unpacked instead of encoded again
+ */
+TEST(stored_symbol)
+{
+	char directory[] = "/tmp/qr-input-XXXXXX", path[64];
+	qr_input_options options = DEFAULTS;
+	qr_code *encoded[QR_APPEND_MAX_SYMBOLS], *stored[QR_APPEND_MAX_SYMBOLS], *other[QR_APPEND_MAX_SYMBOLS];
+	qr_store store;
+
+	test_expect_eq(mkdtemp(directory) != NULL, 1, "Temporary directory is created");
+	test_expect_eq(qr_store_open(options.store = &store, directory), 0, "Store is opened");
+
+	test_expect_eq(qr_input_encode("stored", 6, &options, NULL, encoded), 1, "Symbol is encoded");
+	test_expect_eq(store.misses, 1, "First encoding misses");
+	test_expect_eq(qr_input_encode("stored", 6, &options, NULL, stored), 1, "Symbol is found");
+	test_expect_eq(store.hits, 1, "Second encoding hits");
+	test_expect_eq(memcmp(encoded[0]->matrix, stored[0]->matrix, encoded[0]->side_length * encoded[0]->side_length * sizeof(int)), 0, "Stored symbol is unchanged");
+
+	options.level = QR_EC_LEVEL_H;
+	test_expect_eq(qr_input_encode("stored", 6, &options, NULL, other), 1, "Symbol of another level is encoded");
+	test_expect_eq(store.misses, 2, "Level is part of the key");
+
+	qr_destroy(other[0]);
+	qr_destroy(stored[0]);
+	qr_destroy(encoded[0]);
+	qr_store_close(&store);
+	snprintf(path, sizeof(path), "%s/index", directory);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/symbols", directory);
+	unlink(path);
+	rmdir(directory);
+	return TEST_SUCCESS;
+}
@@ -9,6 +9,7 @@
 #include <test/base.h>
 #include <qr/types.h>
 #include <qr/matrix.h>
+#include <qr/patterns.h>
 #include <string.h>
 
 // Include the source file directly to test static functions
@@ -159,3 +160,93 @@ TEST(module_edge_cases) {
 
 	return TEST_SUCCESS;
 }
+
+/**
+ * @brief Test the alignment pattern positions
+ *
+ * Verifies the number of alignment patterns for small and large versions
+ * and that no pattern overlaps a finder pattern.
+ */
+TEST(alignment_pattern_origins) {
+	size_t origins[QR_MAX_ALIGNMENT_PATTERNS][2];
+	qr_code *qr = create_test_qr(0, 21);
+	if (!qr) return TEST_FAILURE("Failed to create test QR code");
+
+	test_expect_eq(qr_alignment_pattern_origins(qr, origins), 0,
+		"Version 1 has no alignment patterns");
+
+	qr->version = 1;
+	qr->side_length = 25;
+	test_expect_eq(qr_alignment_pattern_origins(qr, origins), 1,
+		"Version 2 has one alignment pattern");
+	test_expect_eq(origins[0][0], 16, "Alignment pattern row");
+	test_expect_eq(origins[0][1], 16, "Alignment pattern column");
+
+	qr->version = 6;
+	qr->side_length = 45;
+	test_expect_eq(qr_alignment_pattern_origins(qr, origins), 6,
+		"Version 7 skips the three positions at the finder patterns");
+
+	qr->version = 39;
+	qr->side_length = 177;
+	test_expect_eq(qr_alignment_pattern_origins(qr, origins), 46,
+		"Version 40 has 46 alignment patterns");
+	test_expect_eq(qr_is_in_alignment_patterns(qr, origins[45][0] + 4, origins[45][1] + 4), 1,
+		"Bottom right corner of the last pattern");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the alignment pattern lookup of single modules
+ *
+ * Verifies for every module of every version that the lookup agrees with
+ * the list of alignment pattern origins.
+ */
+TEST(alignment_pattern_lookup) {
+	size_t origins[QR_MAX_ALIGNMENT_PATTERNS][2], count, i, j, k;
+	int expected;
+	qr_code *qr = create_test_qr(0, 21);
+	if (!qr) return TEST_FAILURE("Failed to create test QR code");
+
+	for (qr->version = 0; qr->version < QR_VERSION_COUNT; ++qr->version) {
+		qr->side_length = 21 + 4 * qr->version;
+		count = qr_alignment_pattern_origins(qr, origins);
+
+		for (i = 0; i < qr->side_length; ++i) {
+			for (j = 0; j < qr->side_length; ++j) {
+				expected = 0;
+				for (k = 0; k < count; ++k)
+					expected |= i >= origins[k][0] && i <= origins[k][0] + 4 && j >= origins[k][1] && j <= origins[k][1] + 4;
+				test_expect_eq(qr_is_in_alignment_patterns(qr, i, j), expected, "Lookup agrees with the origins");
+			}
+		}
+	}
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the extraction of dark runs from a module row
+ */
+TEST(module_runs)
+{
+	static const int row[21] = { 1, 1, 0, 0, 1, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1 };
+	qr_run runs[QR_MAX_RUNS];
+	qr_code *qr = create_test_qr(0, 21);
+	if (!qr) return TEST_FAILURE("Failed to create test QR code");
+
+	memset(qr->matrix, 0, 21 * 21 * sizeof(int));
+	memcpy(qr->matrix + 21, row, sizeof(row));
+
+	test_expect_eq(qr_module_runs(qr, 0, runs), 0, "Light row has no runs");
+	test_expect_eq(qr_module_runs(qr, 1, runs), 4, "Four runs");
+	test_expect_eq(runs[0].begin, 0, "First run starts the row");
+	test_expect_eq(runs[0].length, 2, "First run length");
+	test_expect_eq(runs[2].begin, 6, "Third run start");
+	test_expect_eq(runs[2].length, 3, "Third run length");
+	test_expect_eq(runs[3].begin, 19, "Last run ends the row");
+	test_expect_eq(runs[3].length, 2, "Last run length");
+
+	return TEST_SUCCESS;
+}
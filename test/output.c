@@ -0,0 +1,80 @@
+/**
+ * @file output.c
+ * @brief Test cases for output files and compressed output sinks
+ *
+ * This file contains test cases for suffixed output paths and for wrapping
+ * an output sink in gzip compression.
+ */
+
+#include <test/base.h>
+#include <qr/deflate.h>
+#include <qr/output.h>
+#include <qr/sink.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Include the source file directly to test static functions
+#include "../qr/output.c"
+
+/**
+ * @brief Test that the suffix goes in front of the extension of the file
+ *
+ * A dot in a directory name is not an extension.
+ */
+TEST(suffixed_path)
+{
+	char directory[] = "/tmp/qr.output-XXXXXX", path[64];
+	FILE *stream;
+
+	test_expect_eq(mkdtemp(directory) != NULL, 1, "Temporary directory is created");
+
+	snprintf(path, sizeof(path), "%s/symbol.svg", directory);
+	stream = qr_output_open(path, "-2x");
+	test_expect_eq(stream != NULL, 1, "Suffixed file is opened");
+	fclose(stream);
+	snprintf(path, sizeof(path), "%s/symbol-2x.svg", directory);
+	test_expect_eq(access(path, F_OK), 0, "Suffix is inserted in front of the extension");
+	unlink(path);
+
+	snprintf(path, sizeof(path), "%s/symbol", directory);
+	stream = qr_output_open(path, "-1");
+	test_expect_eq(stream != NULL, 1, "File without extension is opened");
+	fclose(stream);
+	snprintf(path, sizeof(path), "%s/symbol-1", directory);
+	test_expect_eq(access(path, F_OK), 0, "Suffix is appended without an extension");
+	unlink(path);
+
+	rmdir(directory);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that output is passed through or compressed as gzip
+ */
+TEST(gzip_wrap)
+{
+	static const char text[] = "<svg></svg>";
+	qr_output_options options = { .path = NULL, .gzip = NULL, .level = QR_DEFLATE_FAST };
+	qr_buffer buffer = { 0 };
+	qr_output_sink out;
+	qr_deflate gzip;
+
+	qr_sink_memory(&out.base, &buffer);
+	qr_sink_puts(qr_output_wrap(&out, &options), text);
+	test_expect_eq(qr_output_end(&out), 0, "Plain output is written");
+	test_expect_eq(buffer.length == strlen(text) && !memcmp(buffer.data, text, buffer.length), 1, "Plain output is unchanged");
+
+	buffer.length = 0;
+	options.gzip = &gzip;
+	qr_sink_memory(&out.base, &buffer);
+	qr_sink_puts(qr_output_wrap(&out, &options), text);
+	test_expect_eq(qr_output_end(&out), 0, "Compressed output is written");
+	test_expect_gt(buffer.length, 18, "Gzip header and trailer");
+	test_expect_eq((unsigned char) buffer.data[0], 0x1f, "First gzip magic byte");
+	test_expect_eq((unsigned char) buffer.data[1], 0x8b, "Second gzip magic byte");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file pdf.c
+ * @brief Test cases for merged rectangles and the PDF writer
+ *
+ * This file contains test cases for covering the dark modules with
+ * rectangles and for the object offsets of the PDF cross-reference table.
+ */
+
+#include <test/base.h>
+#include <qr/matrix.h>
+#include <qr/qr.h>
+#include <qr/raster.h>
+#include <qr/rects.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/pdf.c"
+
+/**
+ * @brief Test that the rectangles cover exactly the dark modules
+ *
+ * Every dark module must be covered by exactly one rectangle, no light
+ * module by any, and merging must need far fewer rectangles than modules.
+ */
+TEST(rects_cover_dark_modules)
+{
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 9);
+	char *coverage;
+	qr_rect *rects;
+	size_t count, dark = 0, i, j, k;
+
+	qr_encode_message(qr, "rectangles merged horizontally and then vertically");
+	rects = qr_rects_merge(qr, &count);
+	coverage = calloc(qr->side_length * qr->side_length, 1);
+
+	for (k = 0; k < count; ++k)
+	{
+		test_expect_gt(rects[k].width, 0, "Rectangle has a width");
+		test_expect_gt(rects[k].height, 0, "Rectangle has a height");
+		for (i = rects[k].y; i < rects[k].y + rects[k].height; ++i)
+			for (j = rects[k].x; j < rects[k].x + rects[k].width; ++j)
+				++coverage[i * qr->side_length + j];
+	}
+
+	for (i = 0; i < qr->side_length; ++i)
+	{
+		for (j = 0; j < qr->side_length; ++j)
+		{
+			test_expect_eq(coverage[i * qr->side_length + j], qr_module_get(qr, i, j), "Covered once if dark");
+			dark += qr_module_get(qr, i, j);
+		}
+	}
+
+	test_expect_lt(count, dark / 2, "Fewer than one rectangle per two dark modules");
+
+	free(coverage);
+	free(rects);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the cross-reference table
+ *
+ * Every entry must point at the start of its object, startxref at the
+ * table itself, and the stream length object must match the content.
+ */
+TEST(pdf_xref_offsets)
+{
+	qr_raster_options options = { .scale = 3, .quiet_zone = 4 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_L, QR_MODE_BYTE, 0);
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+	char *data, *xref, *entry, *stream, *end, expected[16];
+	size_t k;
+
+	qr_encode_message(qr, "pdf");
+	qr_sink_memory(&sink, &buffer);
+	qr_sink_puts(&sink, "preceding output");
+	qr_pdf_render(qr, &options, &sink);
+	qr_sink_putc(&sink, '\0');
+	qr_sink_flush(&sink);
+
+	// offsets are relative to the start of the document
+	data = buffer.data + strlen("preceding output");
+	test_expect_eq(strncmp(data, "%PDF-1.4\n", 9), 0, "Header");
+
+	xref = data + atol(strstr(data, "startxref\n") + strlen("startxref\n"));
+	test_expect_eq(strncmp(xref, "xref\n0 7\n", 9), 0, "startxref points at the table");
+
+	for (k = 1, entry = xref + 9 + 20; k < 7; ++k, entry += 20)
+	{
+		test_expect_eq(entry[18], ' ', "Entry is 20 bytes");
+		test_expect_eq(entry[19], '\n', "Entry is 20 bytes");
+		snprintf(expected, sizeof(expected), "%zu 0 obj\n", k);
+		test_expect_eq(strncmp(data + atol(entry), expected, strlen(expected)), 0, "Entry points at its object");
+	}
+
+	stream = strstr(data, "stream\n") + strlen("stream\n");
+	end = strstr(stream, "endstream");
+	test_expect_eq(atol(strstr(data, "6 0 obj\n") + strlen("6 0 obj\n")), end - stream, "Stream length");
+	test_expect_eq(strcmp(data + strlen(data) - 6, "%%EOF\n"), 0, "Trailer");
+
+	qr_buffer_free(&buffer);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
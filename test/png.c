@@ -0,0 +1,147 @@
+/**
+ * @file png.c
+ * @brief Test cases for the PNG writer
+ *
+ * This file contains test cases for the PNG chunk layout, the packed
+ * raster rows it compresses and rendering several sizes in one pass.
+ */
+
+#include <test/base.h>
+#include <qr/matrix.h>
+#include <qr/qr.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stdint.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/png.c"
+
+static uint32_t
+get_uint32_be(const uint8_t *bytes)
+{
+	return ((uint32_t) bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+}
+
+/**
+ * @brief Test packing a pixel row
+ *
+ * The first dark pixel of the finder pattern lies right after the quiet
+ * zone, rows inside the quiet zone are entirely light.
+ */
+TEST(raster_pack_row)
+{
+	qr_raster_options options = { .scale = 3, .quiet_zone = 2 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 0);
+	uint8_t row[16];
+	size_t i;
+
+	qr_encode_message(qr, "raster");
+	test_expect_eq(qr_raster_size(qr, &options), 75, "Side length with quiet zone and scale");
+	test_expect_eq(qr_raster_row_bytes(qr, &options, QR_PIXEL_1BPP), 10, "Bytes per packed row");
+
+	qr_raster_pack_row(qr, &options, 5, row);
+	for (i = 0; i < 10; ++i)
+		test_expect_eq(row[i], 0x00, "Quiet zone row is light");
+
+	// the finder pattern starts at pixel 6 and is 7 modules wide
+	qr_raster_pack_row(qr, &options, 6, row);
+	test_expect_eq(row[0], 0x03, "Finder pattern starts after the quiet zone");
+	test_expect_eq(row[1], 0xFF, "Finder pattern top edge");
+	test_expect_eq(row[2], 0xFF, "Finder pattern top edge");
+	test_expect_eq(row[3], 0xE0, "Finder pattern ends after 21 pixels");
+	test_expect_eq(row[9] & 0x1F, 0x00, "Padding bits are cleared");
+
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the chunk layout of a rendered image
+ *
+ * Verifies the signature, the header dimensions and bit depth, the CRC of
+ * every chunk and that the image ends with IEND.
+ */
+TEST(chunks)
+{
+	qr_raster_options options = { .scale = 2, .quiet_zone = 4 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 0);
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+	const uint8_t *data;
+	size_t position, length, idat = 0;
+
+	qr_encode_message(qr, "png");
+	qr_sink_memory(&sink, &buffer);
+	qr_png_render(qr, &options, &sink);
+	test_expect_eq(qr_sink_flush(&sink), 0, "Flush succeeds");
+
+	data = (const uint8_t *) buffer.data;
+	test_expect_eq(memcmp(data, SIGNATURE, sizeof(SIGNATURE)), 0, "Signature");
+	test_expect_eq(memcmp(data + 12, "IHDR", 4), 0, "Header comes first");
+	test_expect_eq(get_uint32_be(data + 16), 58, "Width");
+	test_expect_eq(get_uint32_be(data + 20), 58, "Height");
+	test_expect_eq(data[24], 1, "Bit depth");
+	test_expect_eq(data[25], 0, "Grayscale");
+
+	for (position = sizeof(SIGNATURE); position < buffer.length; position += length + 12)
+	{
+		length = get_uint32_be(data + position);
+		test_expect_le(position + length + 12, buffer.length, "Chunk within the image");
+		test_expect_eq(qr_crc32(0, data + position + 4, length + 4), (int) get_uint32_be(data + position + 8 + length), "Chunk CRC");
+		idat += !memcmp(data + position + 4, "IDAT", 4);
+	}
+
+	test_expect_ge(idat, 1, "Image data present");
+	test_expect_eq(memcmp(data + buffer.length - 8, "IEND", 4), 0, "Image ends with IEND");
+
+	qr_buffer_free(&buffer);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that one pass renders what the single renderers write
+ *
+ * Row ordered formats share the traversal, pdf is rendered on its own
+ * afterwards, every output must match its separate rendering.
+ */
+TEST(render_targets)
+{
+	static const qr_format formats[] = { QR_FORMAT_PNG, QR_FORMAT_PNG, QR_FORMAT_PBM, QR_FORMAT_PGM, QR_FORMAT_SVG_PATH, QR_FORMAT_PDF };
+	static const size_t scales[] = { 1, 9, 3, 2, 1, 4 };
+	enum { COUNT = sizeof(formats) / sizeof(*formats) };
+	qr_code *qr = qr_create(QR_EC_LEVEL_Q, QR_MODE_BYTE, 3);
+	qr_render_target targets[COUNT];
+	qr_buffer together[COUNT] = { { 0 } }, alone = { 0 };
+	qr_sink sinks[COUNT], sink;
+	size_t i;
+
+	qr_encode_message(qr, "one pass, many sizes");
+
+	for (i = 0; i < COUNT; ++i)
+	{
+		qr_sink_memory(&sinks[i], &together[i]);
+		targets[i] = (qr_render_target) { formats[i], { .scale = scales[i], .quiet_zone = i }, &sinks[i] };
+	}
+	qr_render_targets(qr, targets, COUNT);
+
+	for (i = 0; i < COUNT; ++i)
+	{
+		qr_sink_flush(&sinks[i]);
+
+		alone.length = 0;
+		qr_sink_memory(&sink, &alone);
+		qr_render(qr, formats[i], &targets[i].options, &sink);
+		qr_sink_flush(&sink);
+
+		test_expect_eq(together[i].length, alone.length, "Same size as rendered alone");
+		test_expect_eq(memcmp(together[i].data, alone.data, alone.length), 0, "Same bytes as rendered alone");
+		qr_buffer_free(&together[i]);
+	}
+
+	qr_buffer_free(&alone);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
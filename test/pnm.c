@@ -0,0 +1,84 @@
+/**
+ * @file pnm.c
+ * @brief Test cases for PBM and PGM output
+ *
+ * This file contains test cases for the headers and pixel data of the raw
+ * PBM and PGM raster formats, and for rendering them into sized buffers.
+ */
+
+#include <test/base.h>
+#include <qr/qr.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/pnm.c"
+
+/**
+ * @brief Test that PBM and PGM describe the same image
+ *
+ * Every PGM pixel must be black exactly where the corresponding PBM bit is
+ * set, and both must have the size announced in their header.
+ */
+TEST(pbm_pgm_pixels)
+{
+	static const char pbm_header[] = "P4\n62 62\n", pgm_header[] = "P5\n62 62\n255\n";
+	qr_raster_options options = { .scale = 2, .quiet_zone = 5 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_L, QR_MODE_BYTE, 0);
+	qr_buffer pbm = { 0 }, pgm = { 0 };
+	const uint8_t *bits, *pixels;
+	qr_sink sink;
+	size_t x, y;
+
+	qr_encode_message(qr, "pnm");
+
+	qr_sink_memory(&sink, &pbm);
+	qr_pbm_render(qr, &options, &sink);
+	qr_sink_flush(&sink);
+	qr_sink_memory(&sink, &pgm);
+	qr_pgm_render(qr, &options, &sink);
+	qr_sink_flush(&sink);
+
+	test_expect_eq(memcmp(pbm.data, pbm_header, sizeof(pbm_header) - 1), 0, "PBM header");
+	test_expect_eq(memcmp(pgm.data, pgm_header, sizeof(pgm_header) - 1), 0, "PGM header");
+	test_expect_eq(pbm.length, sizeof(pbm_header) - 1 + 62 * 8, "PBM size");
+	test_expect_eq(pgm.length, sizeof(pgm_header) - 1 + 62 * 62, "PGM size");
+
+	bits = (const uint8_t *) pbm.data + sizeof(pbm_header) - 1;
+	pixels = (const uint8_t *) pgm.data + sizeof(pgm_header) - 1;
+	for (y = 0; y < 62; ++y)
+		for (x = 0; x < 62; ++x)
+			test_expect_eq(!(bits[y * 8 + x / 8] & (0x80 >> (x % 8))), pixels[y * 62 + x] == 0xFF, "PBM and PGM agree");
+
+	test_expect_eq(pixels[10 * 62 + 10], 0x00, "Finder pattern corner is black");
+	test_expect_eq(pixels[9 * 62 + 10], 0xFF, "Quiet zone is white");
+
+	qr_buffer_free(&pbm);
+	qr_buffer_free(&pgm);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the size query and rendering into a buffer that is too small
+ */
+TEST(render_buffer)
+{
+	qr_raster_options options = { .scale = 3, .quiet_zone = 4 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 0);
+	static char full[8192], partial[100];
+	size_t size;
+
+	qr_encode_message(qr, "sized");
+
+	size = qr_render_size(qr, QR_FORMAT_PGM, &options);
+	test_expect_eq(size, strlen("P5\n87 87\n255\n") + 87 * 87, "Size of header and pixels");
+	test_expect_eq(qr_render_buffer(qr, QR_FORMAT_PGM, &options, full, sizeof(full)), size, "Same size when it fits");
+	test_expect_eq(qr_render_buffer(qr, QR_FORMAT_PGM, &options, partial, sizeof(partial)), size, "Required size when too small");
+	test_expect_eq(memcmp(full, partial, sizeof(partial)), 0, "Partial output is the beginning");
+
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file pool.c
+ * @brief Test cases for the work-stealing worker pool
+ *
+ * This file contains test cases that run jobs of very different lengths on
+ * a pool and check that every job runs exactly once.
+ */
+
+#include <test/base.h>
+#include <qr/pool.h>
+#include <pthread.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/pool.c"
+
+#define JOB_COUNT 1000
+
+typedef struct
+{
+	pthread_mutex_t lock;
+	unsigned runs[JOB_COUNT];
+	unsigned workers[64];
+} job_counts;
+
+static void
+count_job(void *context, unsigned worker, size_t job)
+{
+	job_counts *counts = context;
+	volatile size_t spin;
+
+	// the first jobs take much longer, so that others steal the rest
+	for (spin = 0; spin < (job < 50 ? 100000 : 100); ++spin);
+
+	pthread_mutex_lock(&counts->lock);
+	++counts->runs[job];
+	++counts->workers[worker];
+	pthread_mutex_unlock(&counts->lock);
+}
+
+/**
+ * @brief Test that every job runs once, also when the pool is reused
+ */
+TEST(jobs_run_once)
+{
+	static job_counts counts;
+	unsigned threads, i, run;
+	qr_pool pool;
+
+	memset(&counts, 0, sizeof(counts));
+	pthread_mutex_init(&counts.lock, NULL);
+	threads = qr_pool_init(&pool, 4);
+	test_expect_ge(threads, 1, "At least the calling thread works");
+	test_expect_le(threads, 4, "No more workers than requested");
+
+	for (run = 0; run < 3; ++run)
+		qr_pool_run(&pool, JOB_COUNT, count_job, &counts);
+	qr_pool_run(&pool, 0, count_job, &counts);
+	qr_pool_run(&pool, 2, count_job, &counts);
+
+	for (i = 0; i < JOB_COUNT; ++i)
+		test_expect_eq(counts.runs[i], i < 2 ? 4 : 3, "Job ran once per run");
+	for (i = threads; i < 64; ++i)
+		test_expect_eq(counts.workers[i], 0, "Only existing workers run jobs");
+
+	qr_pool_destroy(&pool);
+	pthread_mutex_destroy(&counts.lock);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test a pool without other threads
+ */
+TEST(single_worker)
+{
+	static job_counts counts;
+	unsigned i;
+	qr_pool pool;
+
+	memset(&counts, 0, sizeof(counts));
+	pthread_mutex_init(&counts.lock, NULL);
+	test_expect_eq(qr_pool_init(&pool, 0), 1, "Zero threads is the calling thread only");
+
+	qr_pool_run(&pool, JOB_COUNT, count_job, &counts);
+	for (i = 0; i < JOB_COUNT; ++i)
+		test_expect_eq(counts.runs[i], 1, "Job ran once");
+	test_expect_eq(counts.workers[0], JOB_COUNT, "The calling thread ran all jobs");
+
+	qr_pool_destroy(&pool);
+	pthread_mutex_destroy(&counts.lock);
+	return TEST_SUCCESS;
+}
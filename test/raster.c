@@ -0,0 +1,199 @@
+/**
+ * @file raster.c
+ * @brief Test cases for rendering into a caller-provided framebuffer
+ *
+ * This file contains test cases for drawing a symbol into memory owned by
+ * the caller in every supported pixel format, with row stride, offsets and
+ * clipping at the framebuffer edges, for the scanline iterator and for
+ * streaming rows wider than the chunk buffer.
+ */
+
+#include <test/base.h>
+#include <qr/qr.h>
+#include <qr/raster.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <stdint.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/raster.c"
+
+#define FB_WIDTH  100
+#define FB_HEIGHT 90
+#define FB_STRIDE 420
+
+static uint8_t pixels[FB_HEIGHT * FB_STRIDE];
+
+static int
+pixel_is_dark(const qr_framebuffer *framebuffer, size_t x, size_t y)
+{
+	const uint8_t *row = (const uint8_t *) framebuffer->pixels + y * framebuffer->stride;
+
+	switch (framebuffer->format)
+	{
+	case QR_PIXEL_1BPP:   return (row[x / 8] >> (7 - x % 8)) & 1;
+	case QR_PIXEL_GRAY8:  return row[x] == 0x00;
+	case QR_PIXEL_RGBA32: return !memcmp(row + 4 * x, "\x00\x00\x00\xFF", 4);
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Test drawing at an offset in every pixel format
+ *
+ * The symbol is drawn at (13, 7) so that rows do not start on a byte
+ * boundary, and every pixel is compared against the packed reference row.
+ * Bytes outside of the drawn area and beyond the row width must keep
+ * their previous content.
+ */
+TEST(blit_formats)
+{
+	qr_raster_options options = { .scale = 2, .quiet_zone = 1 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_Q, QR_MODE_BYTE, 1);
+	qr_framebuffer framebuffer = { pixels, FB_WIDTH, FB_HEIGHT, FB_STRIDE, QR_PIXEL_1BPP };
+	uint8_t reference[16];
+	size_t format, x, y;
+
+	qr_encode_message(qr, "framebuffer");
+	test_expect_eq(qr_raster_size(qr, &options), 54, "Symbol fits the framebuffer");
+
+	for (format = QR_PIXEL_1BPP; format <= QR_PIXEL_RGBA32; ++format)
+	{
+		framebuffer.format = format;
+		memset(pixels, 0x5A, sizeof(pixels));
+		qr_raster_blit(qr, &options, &framebuffer, 13, 7);
+
+		for (y = 0; y < 54; ++y)
+		{
+			qr_raster_pack_row(qr, &options, y, reference);
+			for (x = 0; x < 54; ++x)
+				test_expect_eq(pixel_is_dark(&framebuffer, 13 + x, 7 + y), (reference[x / 8] >> (7 - x % 8)) & 1, "Pixel matches the packed row");
+		}
+
+		test_expect_eq(pixels[6 * FB_STRIDE + 1], 0x5A, "Row above the symbol is untouched");
+		test_expect_eq(pixels[61 * FB_STRIDE + 1], 0x5A, "Row below the symbol is untouched");
+		test_expect_eq(pixels[7 * FB_STRIDE + FB_STRIDE - 1], 0x5A, "Padding after the row is untouched");
+	}
+
+	test_expect_eq(pixels[7 * FB_STRIDE + 4 * 12], 0x5A, "Pixel left of the symbol is untouched");
+
+	framebuffer.format = QR_PIXEL_1BPP;
+	memset(pixels, 0x5A, sizeof(pixels));
+	qr_raster_blit(qr, &options, &framebuffer, 13, 7);
+	test_expect_eq(pixels[7 * FB_STRIDE + 1] & 0xF8, 0x58, "Bits left of the symbol are untouched");
+
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test clipping at the framebuffer edges
+ */
+TEST(blit_clipping)
+{
+	qr_raster_options options = { .scale = 3, .quiet_zone = 4 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 0);
+	qr_framebuffer framebuffer = { pixels, FB_WIDTH, FB_HEIGHT, FB_STRIDE, QR_PIXEL_GRAY8 };
+	uint8_t reference[16];
+	size_t x, y;
+
+	qr_encode_message(qr, "clip");
+	memset(pixels, 0x5A, sizeof(pixels));
+	qr_raster_blit(qr, &options, &framebuffer, 60, 50);
+
+	for (y = 0; y < FB_HEIGHT - 50; ++y)
+	{
+		qr_raster_pack_row(qr, &options, y, reference);
+		for (x = 0; x < FB_WIDTH - 60; ++x)
+			test_expect_eq(pixel_is_dark(&framebuffer, 60 + x, 50 + y), (reference[x / 8] >> (7 - x % 8)) & 1, "Visible pixel matches the packed row");
+		test_expect_eq(pixels[(50 + y) * FB_STRIDE + FB_WIDTH], 0x5A, "Nothing written past the width");
+	}
+
+	memset(pixels, 0x5A, sizeof(pixels));
+	qr_raster_blit(qr, &options, &framebuffer, FB_WIDTH, 0);
+	qr_raster_blit(qr, &options, &framebuffer, 0, FB_HEIGHT);
+	for (x = 0; x < sizeof(pixels); ++x)
+		test_expect_eq(pixels[x], 0x5A, "Symbol outside of the framebuffer draws nothing");
+
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test the scanline iterator
+ *
+ * Every distinct row is produced once together with the number of pixel
+ * rows it covers, the counts must add up to the image height and each row
+ * must match the packed reference row for all the pixel rows it covers.
+ */
+TEST(scanline_rows)
+{
+	qr_raster_options options = { .scale = 5, .quiet_zone = 3 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_H, QR_MODE_BYTE, 2);
+	uint8_t row[4 * 200], reference[32];
+	qr_scanline scanline;
+	size_t count, y = 0, rows = 0, x;
+
+	qr_encode_message(qr, "scanline");
+	qr_scanline_init(&scanline, qr, &options, QR_PIXEL_GRAY8, row);
+
+	while ((count = qr_scanline_next(&scanline)))
+	{
+		test_expect_eq(count, (y == 0 || y == 15 + 29 * 5) ? 15 : 5, "Quiet zone rows are grouped");
+
+		for (; count; --count, ++y)
+		{
+			qr_raster_pack_row(qr, &options, y, reference);
+			for (x = 0; x < qr_raster_size(qr, &options); ++x)
+				test_expect_eq(row[x] == 0x00, (reference[x / 8] >> (7 - x % 8)) & 1, "Row matches the packed row");
+		}
+		++rows;
+	}
+
+	test_expect_eq(y, qr_raster_size(qr, &options), "Counts add up to the height");
+	test_expect_eq(rows, 29 + 2, "One row per module row and quiet zone");
+	test_expect_eq(qr_scanline_next(&scanline), 0, "Iterator stays finished");
+
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test streaming rows that are drawn in several pieces
+ *
+ * At a scale where one gray row is wider than the chunk buffer the streamed
+ * image must still match the packed rows pixel for pixel.
+ */
+TEST(stream_chunks)
+{
+	qr_raster_options options = { .scale = 200, .quiet_zone = 0 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_L, QR_MODE_BYTE, 0);
+	static uint8_t reference[(21 * 200 + 7) / 8];
+	qr_buffer buffer = { 0 };
+	const uint8_t *row;
+	size_t size, x, y;
+	qr_sink sink;
+
+	qr_encode_message(qr, "chunks");
+	size = qr_raster_size(qr, &options);
+	test_expect_gt(size, QR_RASTER_CHUNK_SIZE, "Row is wider than a chunk");
+
+	qr_sink_memory(&sink, &buffer);
+	qr_raster_stream(qr, &options, QR_PIXEL_GRAY8, &sink);
+	qr_sink_flush(&sink);
+	test_expect_eq(buffer.length, size * size, "Every row is streamed");
+
+	for (y = 0; y < size; y += 199)
+	{
+		qr_raster_pack_row(qr, &options, y, reference);
+		row = (const uint8_t *) buffer.data + y * size;
+		for (x = 0; x < size; ++x)
+			test_expect_eq(row[x] == 0x00, (reference[x / 8] >> (7 - x % 8)) & 1, "Streamed row matches the packed row");
+	}
+
+	qr_buffer_free(&buffer);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file sheet.c
+ * @brief Test cases for the sheet layout
+ *
+ * This file contains test cases for placing many symbols on a grid of
+ * pages, including smaller symbols and captions.
+ */
+
+#include <test/base.h>
+#include <qr/qr.h>
+#include <qr/sheet.h>
+#include <qr/types.h>
+
+// Include the source file directly to test static functions
+#include "../qr/sheet.c"
+
+/**
+ * @brief Test the grid of an A4 sheet
+ *
+ * Version 1 symbols with the default quiet zone at 4 points per module are
+ * 116 points wide, 4 columns and 6 rows with captions fit the page.
+ */
+TEST(layout_grid)
+{
+	qr_sheet_options options = { QR_SHEET_PAGE_WIDTH, QR_SHEET_PAGE_HEIGHT, QR_SHEET_MARGIN, 4, 4, 8 };
+	qr_code *symbols[30];
+	qr_sheet_layout layout;
+	size_t i, page, x, y;
+
+	for (i = 0; i < 30; ++i)
+		symbols[i] = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, i == 29 ? 1 : 0);
+
+	// the largest symbol determines the cell
+	test_expect_eq(qr_sheet_layout_compute(symbols, 29, &options, &layout), 0, "Layout fits");
+	test_expect_eq(layout.box, 116, "Symbol box");
+	test_expect_eq(layout.cell_height, 128, "Box and caption");
+	test_expect_eq(layout.columns, 4, "Columns");
+	test_expect_eq(layout.rows, 6, "Rows");
+	test_expect_eq(layout.pages, 2, "Pages");
+
+	qr_sheet_place(&layout, &options, symbols[25], 25, &page, &x, &y);
+	test_expect_eq(page, 1, "Second page");
+	test_expect_eq(x, 36 + 116, "Second column");
+	test_expect_eq(y, 36, "First row");
+
+	test_expect_eq(qr_sheet_layout_compute(symbols, 30, &options, &layout), 0, "Layout fits");
+	test_expect_eq(layout.box, 132, "Version 2 box");
+	test_expect_eq(layout.columns, 3, "Columns of the larger box");
+	qr_sheet_place(&layout, &options, symbols[0], 4, &page, &x, &y);
+	test_expect_eq(x, 36 + 132 + 8, "Smaller symbol is centered");
+	test_expect_eq(y, 36 + 144 + 8, "Smaller symbol is centered");
+
+	options.page_width = 100;
+	test_expect_eq(qr_sheet_layout_compute(symbols, 30, &options, &layout), -1, "Page too narrow");
+
+	for (i = 0; i < 30; ++i)
+		qr_destroy(symbols[i]);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test caption placement and truncation
+ *
+ * Captions are centered below their symbol and cut to the width of the
+ * cell without splitting a UTF-8 sequence.
+ */
+TEST(caption)
+{
+	qr_sheet_options options = { 200, 200, 10, 2, 2, 10 };
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 0);
+	qr_sheet_layout layout;
+	size_t x, y, length;
+
+	test_expect_eq(qr_sheet_layout_compute(&qr, 1, &options, &layout), 0, "Layout fits");
+	test_expect_eq(layout.cell_width, 50, "Cell width");
+
+	qr_sheet_caption(&layout, &options, 0, "abcd", &x, &y, &length);
+	test_expect_eq(length, 4, "Short caption is kept");
+	test_expect_eq(x, 10 + (50 - 24) / 2, "Caption is centered");
+	test_expect_eq(y, 10 + 50 + 10, "Baseline below the symbol");
+
+	// 6 points per glyph leave room for 8 bytes
+	qr_sheet_caption(&layout, &options, 1, "abcdefghijkl", &x, &y, &length);
+	test_expect_eq(length, 8, "Long caption is cut");
+	qr_sheet_caption(&layout, &options, 1, "abcdefg\xC3\xBC", &x, &y, &length);
+	test_expect_eq(length, 7, "Multibyte character is not split");
+
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/**
+ * @file sink.c
+ * @brief Test cases for the buffered output sink
+ *
+ * This file contains test cases for the output sink shared by all renderers,
+ * including number formatting, buffering of large writes and the memory
+ * backend.
+ */
+
+#include <test/base.h>
+#include <qr/sink.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/sink.c"
+
+static size_t
+failing_write(void *context, const void *data, size_t size)
+{
+	(void) context; (void) data;
+	return size / 2;
+}
+
+/**
+ * @brief Test formatting of unsigned numbers
+ *
+ * Verifies zero, single digits and the largest value representable in a
+ * size_t on 64-bit platforms.
+ */
+TEST(put_uint)
+{
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+
+	qr_sink_memory(&sink, &buffer);
+	qr_sink_put_uint(&sink, 0);
+	qr_sink_putc(&sink, ' ');
+	qr_sink_put_uint(&sink, 7);
+	qr_sink_putc(&sink, ' ');
+	qr_sink_put_uint(&sink, 4096);
+	qr_sink_putc(&sink, ' ');
+	qr_sink_put_uint(&sink, (size_t) 18446744073709551615ULL);
+	test_expect_eq(qr_sink_flush(&sink), 0, "Flush succeeds");
+
+	const char *expected = sizeof(size_t) == 8 ? "0 7 4096 18446744073709551615" : "0 7 4096 4294967295";
+	test_expect_eq(buffer.length, strlen(expected), "Formatted length");
+	test_expect_eq(memcmp(buffer.data, expected, buffer.length), 0, "Formatted digits");
+	test_expect_eq(sink.written, strlen(expected), "Written byte count");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that output is kept in order across the buffer boundary
+ *
+ * Small writes are buffered and large writes bypass the buffer after it has
+ * been flushed, the resulting stream must be identical either way.
+ */
+TEST(ordering)
+{
+	static char large[3 * QR_SINK_BUFFER_SIZE];
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+	size_t i, expected = 0;
+
+	for (i = 0; i < sizeof(large); ++i)
+		large[i] = 'a' + (i % 26);
+
+	qr_sink_memory(&sink, &buffer);
+	for (i = 0; i < QR_SINK_BUFFER_SIZE + 10; ++i, ++expected)
+		qr_sink_putc(&sink, 'x');
+	test_expect_eq(buffer.length, QR_SINK_BUFFER_SIZE, "Full buffer is forwarded");
+
+	qr_sink_put(&sink, large, sizeof(large));
+	expected += sizeof(large);
+	qr_sink_puts(&sink, "end");
+	expected += 3;
+	test_expect_eq(sink.written, expected, "Written counts buffered bytes");
+	test_expect_eq(qr_sink_flush(&sink), 0, "Flush succeeds");
+
+	test_expect_eq(buffer.length, expected, "All bytes forwarded");
+	for (i = 0; i < QR_SINK_BUFFER_SIZE + 10; ++i)
+		test_expect_eq(buffer.data[i], 'x', "Buffered bytes come first");
+	test_expect_eq(memcmp(buffer.data + QR_SINK_BUFFER_SIZE + 10, large, sizeof(large)), 0, "Large write follows in order");
+	test_expect_eq(memcmp(buffer.data + expected - 3, "end", 3), 0, "Trailing write is last");
+
+	qr_buffer_free(&buffer);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a short write is reported and further output dropped
+ */
+TEST(error)
+{
+	qr_sink sink;
+
+	qr_sink_init(&sink, failing_write, NULL);
+	qr_sink_puts(&sink, "short");
+	test_expect_eq(sink.error, 0, "Buffered output is not yet written");
+	test_expect_eq(qr_sink_flush(&sink), -1, "Short write fails the flush");
+	qr_sink_puts(&sink, "more");
+	test_expect_eq(qr_sink_flush(&sink), -1, "Error is sticky");
+
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a fixed buffer keeps what fits and counts the rest
+ */
+TEST(fixed)
+{
+	char data[8];
+	qr_buffer buffer = { data, 0, sizeof(data) };
+	qr_sink sink;
+
+	qr_sink_fixed(&sink, &buffer);
+	qr_sink_puts(&sink, "0123456789");
+	test_expect_eq(qr_sink_flush(&sink), 0, "Overflow is not an error");
+	test_expect_eq(sink.written, 10, "Written counts the whole output");
+	test_expect_eq(buffer.length, sizeof(data), "Buffer is filled");
+	test_expect_eq(memcmp(data, "01234567", 8), 0, "Buffer holds the beginning");
+	test_expect_eq(buffer.capacity, sizeof(data), "Buffer is not grown");
+
+	return TEST_SUCCESS;
+}
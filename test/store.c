@@ -0,0 +1,191 @@
+/**
+ * @file store.c
+ * @brief Test cases for the on-disk symbol store
+ *
+ * This file contains test cases for packing symbols, lookups and the reuse
+ * of stored symbols after the store is opened again.
+ */
+
+#include <test/base.h>
+#include <qr/qr.h>
+#include <qr/store.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Include the source file directly to test static functions
+#include "../qr/store.c"
+
+/**
+ * @brief Creates a symbol with a pattern of modules that depends on seed
+ */
+static qr_code *
+make_symbol(unsigned version, unsigned seed)
+{
+	qr_code *qr = qr_create(QR_EC_LEVEL_Q, QR_MODE_BYTE, version);
+	size_t i;
+
+	qr->mask = seed % 8;
+	for (i = 0; i < qr->side_length * qr->side_length; ++i)
+		qr->matrix[i] = (i * 7 + seed) % 3 == 0;
+
+	return qr;
+}
+
+/**
+ * @brief Compares everything the store keeps of two symbols
+ */
+static int
+same_symbol(const qr_code *a, const qr_code *b)
+{
+	return a->version == b->version && a->level == b->level && a->mode == b->mode && a->mask == b->mask
+		&& a->side_length == b->side_length && !memcmp(a->matrix, b->matrix, a->side_length * a->side_length * sizeof(*a->matrix));
+}
+
+/**
+ * @brief Removes the files of a store and its directory
+ */
+static void
+remove_store(const char *directory)
+{
+	char path[64];
+
+	snprintf(path, sizeof(path), "%s/index", directory);
+	unlink(path);
+	snprintf(path, sizeof(path), "%s/symbols", directory);
+	unlink(path);
+	rmdir(directory);
+}
+
+/**
+ * @brief Test that packed symbols are unpacked unchanged
+ */
+TEST(pack_unpack)
+{
+	qr_code *qr = make_symbol(6, 5), *unpacked = qr_create(QR_EC_LEVEL_L, QR_MODE_NUMERIC, 0);
+	size_t size = qr_symbol_pack(qr, NULL);
+	unsigned char *packed = malloc(size);
+
+	test_expect_eq(size, QR_STORE_PACKED_HEADER + (45 * 45 + 7) / 8, "One bit per module after the header");
+	test_expect_eq(qr_symbol_pack(qr, packed), size, "Packing returns the size");
+	test_expect_eq(qr_symbol_unpack(packed, size, unpacked), 0, "Packed symbol is unpacked");
+	test_expect_eq(same_symbol(qr, unpacked), 1, "Unpacked symbol is unchanged");
+
+	test_expect_eq(qr_symbol_unpack(packed, size - 1, unpacked), -1, "Truncated symbol is rejected");
+	packed[0] = QR_VERSION_COUNT;
+	test_expect_eq(qr_symbol_unpack(packed, size, unpacked), -1, "Invalid version is rejected");
+
+	free(packed);
+	qr_destroy(unpacked);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test lookups and that stored symbols are found after reopening
+ */
+TEST(get_put)
+{
+	char directory[] = "/tmp/qr-store-XXXXXX";
+	qr_code *small = make_symbol(0, 1), *large = make_symbol(39, 2), *found = qr_create(QR_EC_LEVEL_L, QR_MODE_NUMERIC, 0);
+	qr_store store;
+
+	test_expect_eq(mkdtemp(directory) != NULL, 1, "Temporary directory is created");
+	test_expect_eq(qr_store_open(&store, directory), 0, "New store is created");
+	test_expect_eq(qr_store_get(&store, "small", 5, found), 0, "Empty store misses");
+
+	test_expect_eq(qr_store_put(&store, "small", 5, small), 0, "Small symbol is stored");
+	test_expect_eq(qr_store_put(&store, "large", 5, large), 0, "Large symbol is stored");
+	test_expect_eq(qr_store_get(&store, "large", 5, found), 1, "Large symbol is found");
+	test_expect_eq(same_symbol(large, found), 1, "Large symbol is unchanged");
+	test_expect_eq(qr_store_get(&store, "smal", 4, found), 0, "Prefix of a key misses");
+	test_expect_eq(store.hits, 1, "Hits are counted");
+	test_expect_eq(store.misses, 2, "Misses are counted");
+	qr_store_close(&store);
+
+	test_expect_eq(qr_store_open(&store, directory), 0, "Store is opened again");
+	test_expect_eq(qr_store_get(&store, "small", 5, found), 1, "Symbol of an earlier run is found");
+	test_expect_eq(same_symbol(small, found), 1, "Symbol of an earlier run is unchanged");
+	test_expect_eq(qr_store_put(&store, "small", 5, large), 0, "Stored key is kept");
+	test_expect_eq(qr_store_get(&store, "small", 5, found) && same_symbol(small, found), 1, "First symbol of a key stays");
+	qr_store_close(&store);
+
+	remove_store(directory);
+	qr_destroy(found);
+	qr_destroy(large);
+	qr_destroy(small);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a symbol put by one open store is found by another
+ */
+TEST(shared_files)
+{
+	char directory[] = "/tmp/qr-store-XXXXXX";
+	qr_code *qr = make_symbol(3, 4), *found = qr_create(QR_EC_LEVEL_L, QR_MODE_NUMERIC, 0);
+	qr_store writer, reader;
+
+	test_expect_eq(mkdtemp(directory) != NULL, 1, "Temporary directory is created");
+	test_expect_eq(qr_store_open(&writer, directory), 0, "Writer is opened");
+	test_expect_eq(qr_store_open(&reader, directory), 0, "Reader is opened");
+
+	test_expect_eq(qr_store_put(&writer, "key", 3, qr), 0, "Symbol is stored");
+	test_expect_eq(qr_store_get(&reader, "key", 3, found), 1, "Data written after mapping is found");
+	test_expect_eq(same_symbol(qr, found), 1, "Symbol is unchanged");
+
+	qr_store_close(&reader);
+	qr_store_close(&writer);
+	remove_store(directory);
+	qr_destroy(found);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
+
+/**
+ * @brief Test that a full index is doubled and that other open stores follow
+ *
+ * The index starts with 16 slots, so 40 keys double it twice. The second
+ * store still maps the first index, which is retired by the growth.
+ */
+TEST(index_growth)
+{
+	char directory[] = "/tmp/qr-store-XXXXXX", key[16];
+	qr_code *qr = make_symbol(1, 3), *found = qr_create(QR_EC_LEVEL_L, QR_MODE_NUMERIC, 0);
+	qr_store writer, reader;
+	unsigned i;
+
+	test_expect_eq(mkdtemp(directory) != NULL, 1, "Temporary directory is created");
+	test_expect_eq(open_store(&writer, directory, 16), 0, "Small store is created");
+	test_expect_eq(open_store(&reader, directory, 16), 0, "Reader is opened");
+	test_expect_eq(reader.slot_count, 16, "Reader maps the small index");
+
+	for (i = 0; i < 40; ++i)
+	{
+		snprintf(key, sizeof(key), "key-%u", i);
+		test_expect_eq(qr_store_put(&writer, key, strlen(key), qr), 0, "Every symbol is stored");
+	}
+	test_expect_eq(writer.slot_count, 64, "Index is doubled twice");
+	test_expect_eq(get_field(writer.index + USED_FIELD), 40, "Used slots are counted");
+
+	for (i = 0; i < 40; ++i)
+	{
+		snprintf(key, sizeof(key), "key-%u", i);
+		test_expect_eq(qr_store_get(&reader, key, strlen(key), found), 1, "Reader finds every symbol");
+	}
+	test_expect_eq(reader.slot_count, 64, "Reader maps the new index");
+
+	qr_store_close(&reader);
+	qr_store_close(&writer);
+
+	test_expect_eq(qr_store_open(&writer, directory), 0, "Store is opened again");
+	test_expect_eq(writer.slot_count, 64, "Grown index is kept");
+	test_expect_eq(qr_store_get(&writer, "key-39", 6, found) && same_symbol(qr, found), 1, "Last symbol is found");
+	qr_store_close(&writer);
+
+	remove_store(directory);
+	qr_destroy(found);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}
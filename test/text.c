@@ -0,0 +1,62 @@
+/**
+ * @file text.c
+ * @brief Test cases for the half-block terminal renderer
+ *
+ * This file contains test cases for packing two module rows into one line
+ * of Unicode half-block characters.
+ */
+
+#include <test/base.h>
+#include <qr/matrix.h>
+#include <qr/qr.h>
+#include <qr/sink.h>
+#include <qr/types.h>
+#include <string.h>
+
+// Include the source file directly to test static functions
+#include "../qr/text.c"
+
+/**
+ * @brief Test that every character encodes the two modules it covers
+ *
+ * Decodes the output back into light and dark modules, including the
+ * quiet zone and the half-empty last line of an odd number of rows.
+ */
+TEST(half_blocks)
+{
+	qr_code *qr = qr_create(QR_EC_LEVEL_M, QR_MODE_BYTE, 0);
+	qr_buffer buffer = { 0 };
+	qr_sink sink;
+	const char *line;
+	size_t i, j, k, lines = 0;
+
+	qr_encode_message(qr, "half blocks");
+	qr_sink_memory(&sink, &buffer);
+	qr_text_render(qr, 2, 0, &sink);
+	qr_sink_flush(&sink);
+
+	// 25 module rows take 13 lines
+	for (line = buffer.data, i = 0; line < buffer.data + buffer.length; i += 2, ++lines)
+	{
+		for (j = 0; j < 25; ++j)
+		{
+			for (k = 0; k < 4 && strncmp(line, HALF_BLOCKS[k], strlen(HALF_BLOCKS[k])); ++k);
+			test_expect_lt(k, 4, "Half-block character");
+
+			test_expect_eq(k & 1, module_is_light(qr, 2, i, j), "Top module");
+			if (i + 1 < 25) test_expect_eq(k >> 1, module_is_light(qr, 2, i + 1, j), "Bottom module");
+			else test_expect_eq(k >> 1, 0, "Nothing below the last row");
+
+			line += strlen(HALF_BLOCKS[k]);
+		}
+		test_expect_eq(*line++, '\n', "Line ends after the quiet zone");
+	}
+
+	test_expect_eq(lines, 13, "Two module rows per line");
+	test_expect_eq(module_is_light(qr, 2, 2, 2), 0, "Finder pattern corner is dark");
+	test_expect_eq(module_is_light(qr, 2, 1, 2), 1, "Quiet zone is light");
+
+	qr_buffer_free(&buffer);
+	qr_destroy(qr);
+	return TEST_SUCCESS;
+}